@@ -0,0 +1,244 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <random>
+#include <algorithm>
+
+#include <boost/program_options.hpp>
+namespace bpo = boost::program_options;
+
+#include "../libahafront/aha/front/formatter.hpp"
+#include "../libahafront/aha/front/module_loader.hpp"
+
+using namespace aha::front;
+namespace fs = std::filesystem;
+
+namespace
+{
+    enum class file_status
+    {
+        unchanged, reformatted, error
+    };
+
+    struct file_result
+    {
+        file_status status = file_status::unchanged;
+        std::string message;
+    };
+
+    bool read_file(const fs::path& path, std::string& content)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return !file.bad();
+    }
+
+    // write to a temporary file and rename it, so that the file is never left half-written
+    bool write_file(const fs::path& path, const std::string& content)
+    {
+        auto tmp = path;
+        tmp += ".tmp" + std::to_string(std::random_device{ }());
+
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            file.write(content.data(), content.size());
+
+            if (!file)
+            {
+                file.close();
+                std::error_code ec;
+                fs::remove(tmp, ec);
+                return false;
+            }
+        }
+
+        // the new file keeps the permissions of the one it replaces
+        std::error_code ec;
+        fs::permissions(tmp, fs::status(path, ec).permissions(), ec);
+        if (!ec)
+            fs::rename(tmp, path, ec);
+        if (ec)
+        {
+            fs::remove(tmp, ec);
+            return false;
+        }
+
+        return true;
+    }
+
+    file_result format_file(const fs::path& path, const format_options& opts, bool check)
+    {
+        file_result ret;
+        std::string content;
+
+        if (!read_file(path, content))
+        {
+            ret.status = file_status::error;
+            ret.message = path.string() + ": cannot read file";
+            return ret;
+        }
+
+        std::string formatted;
+        try
+        {
+            formatted = format_source(content, path.string(), opts);
+        }
+        catch (format_error& ex)
+        {
+            ret.status = file_status::error;
+            ret.message = ex.what();
+            return ret;
+        }
+        catch (std::exception& ex)
+        {
+            ret.status = file_status::error;
+            ret.message = path.string() + ": " + ex.what();
+            return ret;
+        }
+
+        // files already formatted are not touched at all
+        if (formatted == content)
+            return ret;
+
+        ret.status = file_status::reformatted;
+
+        if (!check && !write_file(path, formatted))
+        {
+            ret.status = file_status::error;
+            ret.message = path.string() + ": cannot write file";
+        }
+
+        return ret;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bpo::options_description opt("Options:");
+    opt.add_options()
+        ("help,h", "Display this information")
+        ("input", bpo::value<std::vector<std::string>>(), "files or directories to format (*.aha in directories)")
+        ("check", "do not write; fail if any file would be reformatted")
+        ("jobs,j", bpo::value<unsigned>()->default_value(0), "number of worker threads (0: number of cores)")
+        ("indent-width", bpo::value<unsigned>()->default_value(4), "spaces per indentation level")
+        ("max-blank-lines", bpo::value<unsigned>()->default_value(1), "longest run of blank lines to keep")
+        ;
+    bpo::positional_options_description pos;
+    pos.add("input", -1);
+
+    bpo::variables_map vm;
+
+    try
+    {
+        bpo::command_line_parser parser(argc, argv);
+        parser.options(opt);
+        parser.positional(pos);
+
+        bpo::store(parser.run(), vm);
+        bpo::notify(vm);
+    }
+    catch (bpo::error& e)
+    {
+        std::cerr << e.what() << "\n\n" << opt << "\n";
+        return -1;
+    }
+
+    if (vm.count("help") || !vm.count("input"))
+    {
+        std::cout << "Usage: aha-fmt [options] <file or directory>...\n" << opt << "\n";
+        return vm.count("help") ? 0 : -1;
+    }
+
+    format_options opts;
+    opts.indent_width = vm["indent-width"].as<unsigned>();
+    opts.max_blank_lines = vm["max-blank-lines"].as<unsigned>();
+
+    bool check = vm.count("check") != 0;
+
+    auto files = collect_files(vm["input"].as<std::vector<std::string>>());
+
+    // larger files first, so that a big file at the end does not keep one worker busy alone
+    std::vector<std::uintmax_t> sizes(files.size());
+    std::vector<std::size_t> order(files.size());
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        std::error_code ec;
+        sizes[i] = fs::file_size(files[i], ec);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) { return sizes[lhs] > sizes[rhs]; });
+
+    auto jobs = vm["jobs"].as<unsigned>();
+    if (jobs == 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    jobs = static_cast<unsigned>(std::min<std::size_t>(jobs, std::max<std::size_t>(files.size(), 1)));
+
+    std::vector<file_result> results(files.size());
+    std::atomic<std::size_t> next { 0 };
+
+    auto worker = [&] {
+        std::size_t idx;
+        while ((idx = next.fetch_add(1, std::memory_order_relaxed)) < order.size())
+            results[order[idx]] = format_file(files[order[idx]], opts, check);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < jobs; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& th : threads)
+        th.join();
+
+    std::size_t reformatted = 0, errors = 0;
+
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        switch (results[i].status)
+        {
+            case file_status::reformatted:
+                ++reformatted;
+                std::cout << (check ? "would reformat " : "reformatted ") << files[i].string() << "\n";
+                break;
+            case file_status::error:
+                ++errors;
+                std::cerr << results[i].message << std::endl;
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::cout << files.size() << " files, " << reformatted << (check ? " would be reformatted, " : " reformatted, ")
+        << errors << " errors" << std::endl;
+
+    return (errors != 0 || (check && reformatted != 0)) ? 1 : 0;
+}
@@ -21,35 +21,504 @@
 // SOFTWARE.
 
 #include <iostream>
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <type_traits>
 #include <variant>
 #include <locale>
+#include <charconv>
+#include <sstream>
+#include <vector>
+#include <filesystem>
 
 #include <boost/program_options.hpp>
-#include <boost/iterator/transform_iterator.hpp>
 namespace bpo = boost::program_options;
 
 #include "../libahafront/aha/front/source.hpp"
 #include "../libahafront/aha/front/lexer.hpp"
+#include "../libahafront/aha/front/push_lexer.hpp"
+#include "../libahafront/aha/front/token_cache.hpp"
 #include "../libahafront/aha/front/parser.hpp"
+#include "../libahafront/aha/front/diagnostics.hpp"
+#include "../libahafront/aha/front/thread_pool.hpp"
+#include "../libahafront/aha/front/pipeline.hpp"
+#include "../libahafront/aha/front/module_loader.hpp"
+#include "../libahafront/aha/front/stats.hpp"
+#include "../libahafront/aha/front/trace.hpp"
+#include "../libahafront/aha/front/memory.hpp"
+
+#include "token_dump.h"
 
 using namespace aha::front;
 
-inline std::string utf32narrow(std::u32string_view str)
+inline void print_token(const token& tok, bool& interpolated)
+{
+    std::string line;
+    format_token(line, tok, dump_format::text, interpolated);
+    std::cout << line;
+}
+
+inline void print_error(source_positional_error& ex, std::ostream& os = std::cerr)
+{
+    auto pos = ex.getPosition();
+    os << ex.getSource().getName() << ":" << (pos.line + 1) << ":" << (pos.col + 1) << ": " << ex.what() << std::endl;
+}
+
+inline int lex_file(const std::string& path, token_cache* cache, front_stats* stats)
+{
+    std::string content;
+    {
+        trace_span span("read", path);
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << path << ": cannot open file" << std::endl;
+            return -1;
+        }
+
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    auto hash = hash_source(content);
+
+    counting_resource counter;
+    repl_source src(path, &counter);
+    bool interpolated = false;
+
+    // cached tokens refer to src as well, so it holds the content either way
+    src.feedString(content);
+    src.feedEof();
+
+    if (cache)
+    {
+        if (auto view = cache->find(hash, content.size()))
+        {
+            for (auto& rec : *view)
+                print_token(view->makeToken(rec, src), interpolated);
+
+            return 0;
+        }
+    }
+
+    lexer ll(&counter);
+    std::pmr::vector<token> tokens(&counter);
+
+    src.setStats(stats);
+    ll.setStats(stats);
+
+    try
+    {
+        trace_span span("lex", path);
+
+        while (auto tok = ll.lex(src))
+            tokens.push_back(std::move(*tok));
+    }
+    catch (source_positional_error& ex)
+    {
+        print_error(ex);
+        return -1;
+    }
+
+    if (stats)
+    {
+        stats->allocations += counter.getAllocations();
+        stats->allocated_bytes += counter.getAllocatedBytes();
+    }
+
+    trace_span span("print", path);
+
+    for (auto& tok : tokens)
+        print_token(tok, interpolated);
+
+    if (cache)
+        cache->store(hash, content.size(), tokens);
+
+    return 0;
+}
+
+// prints the tokens of stdin as each line arrives
+inline int lex_stdin(front_stats* stats)
 {
-    auto fn = [](char32_t ch) { return static_cast<char>(ch); };
-    auto tbeg = boost::iterators::make_transform_iterator(str.begin(), fn);
-    auto tend = boost::iterators::make_transform_iterator(str.end(), fn);
-    return std::string(tbeg, tend);
+    bool interpolated = false;
+    push_lexer pl([&](token&& tok) { print_token(tok, interpolated); }, "<stdin>");
+    pl.getLexer().setStats(stats);
+
+    try
+    {
+        std::string line;
+        while (std::getline(std::cin, line))
+        {
+            if (!std::cin.eof())
+                line += '\n';
+            pl.feed(line);
+        }
+
+        pl.feedEof();
+    }
+    catch (source_positional_error& ex)
+    {
+        print_error(ex);
+        return -1;
+    }
+
+    return 0;
+}
+
+inline int dump_tokens(const std::vector<std::string>& inputs, const std::string& out_path, const std::string& format_name)
+{
+    auto files = collect_files(inputs);
+
+    auto read_file = [](const std::filesystem::path& path, std::string& content) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << path.string() << ": cannot open file" << std::endl;
+            return false;
+        }
+
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    };
+
+    std::string content;
+
+    // the token stream of the token cache, for a single file without errors
+    if (format_name == "binary")
+    {
+        if (files.size() != 1 || out_path == "-")
+        {
+            std::cerr << "binary token dump needs a single input file and an output file" << std::endl;
+            return -1;
+        }
+
+        if (!read_file(files[0], content))
+            return -1;
+
+        repl_source src(files[0].string());
+        lexer ll;
+        std::vector<token> tokens;
+
+        src.feedString(content);
+        src.feedEof();
+
+        try
+        {
+            while (auto tok = ll.lex(src))
+                tokens.push_back(std::move(*tok));
+        }
+        catch (source_positional_error& ex)
+        {
+            print_error(ex);
+            return -1;
+        }
+
+        if (!write_token_stream(out_path, hash_source(content), content.size(), tokens))
+        {
+            std::cerr << out_path << ": cannot write" << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    dump_format format;
+    if (format_name == "text")
+        format = dump_format::text;
+    else if (format_name == "jsonl")
+        format = dump_format::jsonl;
+    else
+    {
+        std::cerr << "unknown dump format: " << format_name << std::endl;
+        return -1;
+    }
+
+    std::ofstream out_file;
+    if (out_path != "-")
+    {
+        out_file.open(out_path, std::ios::binary);
+        if (!out_file)
+        {
+            std::cerr << out_path << ": cannot write" << std::endl;
+            return -1;
+        }
+    }
+
+    std::ostream& os = (out_path == "-" ? std::cout : out_file);
+
+    int ret = 0;
+    {
+        token_dumper dumper(os, format);
+        lexer ll;
+        diagnostics diag;
+
+        // errors are dumped as error tokens
+        ll.setDiagnostics(&diag);
+
+        for (auto& path : files)
+        {
+            if (!read_file(path, content))
+            {
+                ret = -1;
+                continue;
+            }
+
+            repl_source src(path.string());
+            src.feedString(content);
+            src.feedEof();
+
+            ll.clearAll();
+            diag.clear();
+
+            dumper.beginFile(path.string());
+
+            try
+            {
+                while (auto tok = ll.lex(src))
+                    dumper.dump(*tok);
+            }
+            catch (source_positional_error& ex)
+            {
+                print_error(ex);
+                ret = -1;
+            }
+        }
+    }
+
+    if (!os.flush())
+    {
+        std::cerr << out_path << ": cannot write" << std::endl;
+        return -1;
+    }
+
+    return ret;
+}
+
+// reused for every file the worker checks
+struct check_worker
+{
+    lexer ll;
+    parser yy;
+    diagnostics diag;
+    diagnostics parse_diag;
+    front_stats stats;
 };
 
+// checks a file with the worker. if parse_pool is set, the file is parsed on it.
+// if cache is set, the tokens are taken from it, or stored to it after lexing without errors.
+inline std::string check_file(check_worker& w, const std::filesystem::path& path, token_cache* cache, bool stats,
+    thread_pool* parse_pool)
+{
+    auto name = path.string();
+    std::ostringstream os;
+
+    trace_span file_span("check", name);
+
+    std::string content;
+    {
+        trace_span span("read", name);
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return name + ": cannot open file\n";
+
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // everything of this file is freed at once; a decoded character takes 4 bytes
+    std::pmr::monotonic_buffer_resource arena(content.size() * 4 + 4096);
+    counting_resource counter(&arena);
+
+    repl_source src(name, &counter);
+    src.feedString(content);
+    src.feedEof();
+
+    w.ll.clearAll();
+    w.ll.setTokenResource(&counter);
+    w.diag.clear();
+    w.ll.setDiagnostics(&w.diag);
+
+    // the tree of the module lives in the arena of the file as well
+    w.yy.setModuleResource(&counter);
+    w.yy.clearAll();
+    w.parse_diag.clear();
+    w.yy.setDiagnostics(&w.parse_diag);
+
+    if (stats)
+    {
+        src.setStats(&w.stats);
+        w.ll.setStats(&w.stats);
+    }
+
+    // decoding is done on demand while lexing, so it is in the span of lexing
+    std::pmr::vector<token> tokens(&counter);
+    auto hash = cache ? hash_source(content) : 0;
+
+    try
+    {
+        std::optional<token_stream_view> view;
+        if (cache)
+            view = cache->find(hash, content.size());
+
+        if (view)
+        {
+            trace_span span("load", name);
+            tokens.reserve(view->size());
+            for (auto& rec : *view)
+                tokens.push_back(view->makeToken(rec, src, &counter));
+        }
+        else
+        {
+            {
+                trace_span span("lex", name);
+                while (auto tok = w.ll.lex(src))
+                    tokens.push_back(std::move(*tok));
+            }
+
+            if (cache && w.diag.get().empty())
+                cache->store(hash, content.size(), tokens);
+        }
+
+        trace_span span("parse", name);
+        if (parse_pool)
+        {
+            // dropped here, before the arena goes away
+            parse_parallel(tokens, *parse_pool, &w.parse_diag, &counter);
+        }
+        else
+        {
+            for (auto& tok : tokens)
+                w.yy.parse(std::move(tok));
+            w.yy.finish();
+        }
+    }
+    catch (source_positional_error& ex)
+    {
+        print_error(ex, os);
+    }
+
+    for (auto& d : w.diag.get())
+        os << name << ":" << (d.pos.line + 1) << ":" << (d.pos.col + 1) << ": lexer error: " << d.message << "\n";
+    for (auto& d : w.parse_diag.get())
+        os << name << ":" << (d.pos.line + 1) << ":" << (d.pos.col + 1) << ": parser error: " << d.message << "\n";
+
+    if (stats)
+    {
+        w.stats.allocations += counter.getAllocations();
+        w.stats.allocated_bytes += counter.getAllocatedBytes();
+    }
+
+    // drop the tree before the arena goes away
+    w.yy.setModuleResource(nullptr);
+    w.yy.clearAll();
+
+    return os.str();
+}
+
+inline int check_files(const std::vector<std::string>& inputs, token_cache* cache, unsigned jobs, bool parallel_parse,
+    front_stats* stats)
+{
+    auto files = collect_files(inputs);
+
+    thread_pool pool(jobs);
+    std::vector<check_worker> workers(pool.size());
+
+    // errors of each file, printed in the order of files after all are checked
+    std::vector<std::string> reports(files.size());
+
+    if (parallel_parse)
+    {
+        // one file at a time, each parsed on every thread
+        for (std::size_t i = 0; i < files.size(); ++i)
+            reports[i] = check_file(workers[0], files[i], cache, stats, &pool);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < files.size(); ++i)
+        {
+            pool.submit([&, i](unsigned worker) {
+                reports[i] = check_file(workers[worker], files[i], cache, stats, nullptr);
+            });
+        }
+
+        pool.wait();
+    }
+
+    if (stats)
+    {
+        for (auto& w : workers)
+            stats->merge(w.stats);
+    }
+
+    std::size_t failed = 0;
+    for (auto& report : reports)
+    {
+        if (!report.empty())
+        {
+            std::cerr << report;
+            ++failed;
+        }
+    }
+
+    std::cout << files.size() << " files, " << failed << " with errors" << std::endl;
+    return failed ? -1 : 0;
+}
+
+inline int check_modules(const std::vector<std::string>& inputs, const std::vector<std::string>& module_paths, unsigned jobs,
+    front_stats* stats)
+{
+    auto files = collect_files(inputs);
+
+    thread_pool pool(jobs);
+    module_loader loader(pool, std::vector<std::filesystem::path>(module_paths.begin(), module_paths.end()));
+    // every body is checked
+    loader.setLazyBodies(false);
+    loader.setStats(stats);
+
+    auto graph = loader.load(files);
+
+    std::size_t failed = 0;
+    for (auto& unit : graph.modules)
+    {
+        auto name = unit->path.string();
+
+        for (auto& d : unit->lexer_errors)
+            std::cerr << name << ":" << (d.pos.line + 1) << ":" << (d.pos.col + 1) << ": lexer error: " << d.message << "\n";
+        for (auto& d : unit->parser_errors)
+            std::cerr << name << ":" << (d.pos.line + 1) << ":" << (d.pos.col + 1) << ": parser error: " << d.message << "\n";
+
+        if (!unit->lexer_errors.empty() || !unit->parser_errors.empty())
+            ++failed;
+    }
+
+    for (auto& e : graph.errors)
+        std::cerr << e.path.string() << ":" << (e.pos.line + 1) << ":" << (e.pos.col + 1) << ": import error: " << e.message << "\n";
+
+    std::cout << graph.modules.size() << " modules, " << failed << " with errors, "
+        << graph.errors.size() << " import errors" << std::endl;
+    return (failed || !graph.errors.empty()) ? -1 : 0;
+}
+
 int main(int argc, char* argv[])
 {
-    /*bpo::options_description opt("Options:");
+    bpo::options_description opt("Options:");
     opt.add_options()
         ("help,h", "Display this information")
-        ("input", bpo::value<std::string>()->required(), "specify input source file")
+        ("input", bpo::value<std::vector<std::string>>(), "source file to print the tokens of ('-' for stdin), or several files or "
+            "directories (*.aha in directories) to check in parallel. a single file is checked as well with --jobs or --parallel-parse. "
+            "REPL if omitted")
+        ("token-cache", bpo::value<std::string>(), "directory to cache the tokens of input files")
+        ("jobs,j", bpo::value<unsigned>()->default_value(0), "number of threads to check files (0: number of cores)")
+        ("module-path,I", bpo::value<std::vector<std::string>>(), "directory to find imported modules in; "
+            "the inputs are checked together with the modules they import")
+        ("parallel-parse", "check files one at a time, parsing the top-level declarations of each file in parallel "
+            "(for a few huge files)")
+        ("stats", bpo::value<std::string>()->implicit_value("text"), "print front-end statistics of input files to stderr, as 'text' or 'json'")
+        ("trace", bpo::value<std::string>(), "write a timeline of the front-end phases to the file as Chrome trace-event JSON")
+        ("dump-tokens", bpo::value<std::string>(), "write the tokens of input files to the file ('-' for stdout) instead of printing them")
+        ("dump-format", bpo::value<std::string>()->default_value("text"), "format of --dump-tokens: 'text', 'jsonl' "
+            "or 'binary' (the token cache format, for a single file)")
         ;
     bpo::positional_options_description pos;
     pos.add("input", -1);
@@ -75,7 +544,95 @@ int main(int argc, char* argv[])
     {
         std::cout << opt << "\n";
         return 0;
-    }*/
+    }
+
+    if (vm.count("input"))
+    {
+        auto& inputs = vm["input"].as<std::vector<std::string>>();
+
+        if (vm.count("dump-tokens"))
+            return dump_tokens(inputs, vm["dump-tokens"].as<std::string>(), vm["dump-format"].as<std::string>());
+
+        std::optional<front_stats> stats;
+        if (vm.count("stats"))
+        {
+            auto& format = vm["stats"].as<std::string>();
+            if (format != "text" && format != "json")
+            {
+                std::cerr << "--stats must be 'text' or 'json'\n\n" << opt << "\n";
+                return -1;
+            }
+            if (!front_stats::enabled())
+                std::cerr << "warning: libahafront is built with AHA_FRONT_STATS=0, so no statistics are counted\n";
+
+            stats.emplace();
+        }
+
+        if (vm.count("trace"))
+            tracer::enable(true);
+
+        std::optional<token_cache> cache;
+        if (vm.count("token-cache"))
+            cache.emplace(vm["token-cache"].as<std::string>());
+
+        // these only mean something when checking, so a single file is checked rather than printed
+        bool check_only = !vm["jobs"].defaulted() || vm.count("parallel-parse");
+        if (check_only && inputs.size() == 1 && inputs[0] == "-")
+        {
+            std::cerr << "--jobs and --parallel-parse cannot be used with stdin\n\n" << opt << "\n";
+            return -1;
+        }
+
+        int ret;
+
+        if (vm.count("module-path"))
+        {
+            if (cache)
+            {
+                std::cerr << "--token-cache cannot be used with --module-path\n\n" << opt << "\n";
+                return -1;
+            }
+
+            ret = check_modules(inputs, vm["module-path"].as<std::vector<std::string>>(), vm["jobs"].as<unsigned>(),
+                stats ? &*stats : nullptr);
+        }
+        else if (inputs.size() > 1 || std::filesystem::is_directory(inputs[0]) || check_only)
+        {
+            ret = check_files(inputs, cache ? &*cache : nullptr, vm["jobs"].as<unsigned>(), vm.count("parallel-parse") != 0,
+                stats ? &*stats : nullptr);
+        }
+        else if (inputs[0] == "-")
+        {
+            ret = lex_stdin(stats ? &*stats : nullptr);
+        }
+        else
+        {
+            ret = lex_file(inputs[0], cache ? &*cache : nullptr, stats ? &*stats : nullptr);
+        }
+
+        if (stats)
+        {
+            if (vm["stats"].as<std::string>() == "json")
+                stats->printJson(std::cerr);
+            else
+                stats->print(std::cerr);
+        }
+
+        if (vm.count("trace"))
+        {
+            auto& trace_path = vm["trace"].as<std::string>();
+
+            std::ofstream file(trace_path, std::ios::binary);
+            tracer::writeJson(file);
+            if (!file)
+            {
+                std::cerr << trace_path << ": cannot write" << std::endl;
+                return -1;
+            }
+        }
+
+        return ret;
+    }
 
     repl_source src;
     lexer ll;
@@ -120,11 +677,6 @@ int main(int argc, char* argv[])
 
     bool interpolated = false;
 
-    auto print_error = [](source_positional_error& ex) {
-        auto pos = ex.getPosition();
-        std::cerr << ex.getSource().getName() << ":" << (pos.line + 1) << ":" << (pos.col + 1) << ": " << ex.what() << std::endl;
-    };
-
     while (true)
     {
         try
@@ -155,97 +707,7 @@ int main(int argc, char* argv[])
                 }
             }
 
-            if (std::holds_alternative<token_indent>(tok->data))
-            {
-                auto t = std::get<token_indent>(tok->data);
-                std::cout << "indent { " << t.level << " }\n";
-            }
-            else if (std::holds_alternative<token_newline>(tok->data))
-            {
-                auto t = std::get<token_newline>(tok->data);
-                std::cout << "newline {}\n";
-            }
-            else if (std::holds_alternative<token_punct>(tok->data))
-            {
-                auto t = std::get<token_punct>(tok->data);
-                auto str = utf32narrow(t.str);
-                std::cout << "punct { '" << str << "' }\n";
-            }
-            else if (std::holds_alternative<token_keyword>(tok->data))
-            {
-                auto t = std::get<token_keyword>(tok->data);
-                auto str = utf32narrow(t.str);
-                std::cout << "keyword { '" << str << "' }\n";
-            }
-            else if (std::holds_alternative<token_contextual_keyword>(tok->data))
-            {
-                auto t = std::get<token_contextual_keyword>(tok->data);
-                auto str = utf32narrow(t.str);
-                std::cout << "contextual keyword { '" << str << "' }\n";
-            }
-            else if (std::holds_alternative<token_identifier>(tok->data))
-            {
-                auto t = std::get<token_identifier>(tok->data);
-                auto str = utf32narrow(t.str);
-                std::cout << "identifier { '" << str << "' }\n";
-            }
-            else if (std::holds_alternative<token_number>(tok->data))
-            {
-                auto t = std::get<token_number>(tok->data);
-                if (!t.is_float)
-                {
-                    std::cout << "integer [radix:" << t.radix << "] { " << t.integer << t.postfix << " }\n";
-                }
-                else
-                {
-                    std::cout << "float [radix:" << t.radix << "] { " << t.integer;
-                    if (!t.fraction.empty())
-                        std::cout << "." << t.fraction;
-                    if (!t.exponent.empty())
-                        std::cout << (t.radix == 10 ? "e" : "p") << t.exponent;
-                    std::cout << t.postfix << " }\n";
-                }
-            }
-            else if (std::holds_alternative<token_normal_string>(tok->data))
-            {
-                auto t = std::get<token_normal_string>(tok->data);
-                auto str = utf32narrow(t.str);
-                auto deli = static_cast<char>(t.delimiter);
-                std::cout << "normal string { " << deli << str << deli << " }\n";
-            }
-            else if (std::holds_alternative<token_raw_string>(tok->data))
-            {
-                auto t = std::get<token_raw_string>(tok->data);
-                auto str = utf32narrow(t.str);
-                auto deli = static_cast<char>(t.delimiter);
-                std::cout << "raw string { " << deli << str << deli << " }\n";
-            }
-            else if (std::holds_alternative<token_interpol_string_start>(tok->data))
-            {
-                auto t = std::get<token_interpol_string_start>(tok->data);
-                auto str = utf32narrow(t.str);
-                std::cout << "interpolated string (start) { `" << str << "{ }\n";
-
-                interpolated = true;
-            }
-            else if (std::holds_alternative<token_interpol_string_mid>(tok->data))
-            {
-                auto t = std::get<token_interpol_string_mid>(tok->data);
-                auto str = utf32narrow(t.str);
-                std::cout << "interpolated string (mid) { }" << str << "${ }\n";
-            }
-            else if (std::holds_alternative<token_interpol_string_end>(tok->data))
-            {
-                auto t = std::get<token_interpol_string_end>(tok->data);
-                auto str = utf32narrow(t.str);
-                std::cout << "interpolated string (end) { " << (interpolated ? '}' : '`') << str << "` }\n";
-
-                interpolated = false;
-            }
-            else
-            {
-                throw std::logic_error("add handler ...");
-            }
+            print_token(*tok, interpolated);
         }
         catch (lexer_error& ex)
         {
@@ -0,0 +1,298 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "token_dump.h"
+
+#include <charconv>
+#include <type_traits>
+
+using namespace aha::front;
+
+namespace
+{
+    constexpr std::size_t buffer_size = 1 << 20;
+
+    // overloaded lambdas for std::visit
+    template <typename... Fs>
+    struct overloaded : Fs...
+    {
+        using Fs::operator()...;
+    };
+    template <typename... Fs>
+    overloaded(Fs...) -> overloaded<Fs...>;
+
+    std::string_view u8view(std::u8string_view str)
+    {
+        return std::string_view(reinterpret_cast<const char*>(str.data()), str.size());
+    }
+
+    const char* postfix_str(number_postfix postfix)
+    {
+        switch (postfix)
+        {
+            case number_postfix::u: return "u";
+            case number_postfix::l: return "l";
+            case number_postfix::ul: return "ul";
+            case number_postfix::f: return "f";
+            case number_postfix::d: return "d";
+            default: return "";
+        }
+    }
+
+    template <typename T>
+    void append_number(std::string& out, T value)
+    {
+        char buf[32];
+        auto rs = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, rs.ptr);
+    }
+
+    // the text is valid UTF-8, so only quotes, backslashes and control characters are escaped
+    void append_json_string(std::string& out, std::string_view str)
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        out += '"';
+        for (char ch : str)
+        {
+            auto uch = static_cast<unsigned char>(ch);
+            if (ch == '"' || ch == '\\')
+            {
+                out += '\\';
+                out += ch;
+            }
+            else if (ch == '\n')
+            {
+                out += "\\n";
+            }
+            else if (ch == '\t')
+            {
+                out += "\\t";
+            }
+            else if (uch < 0x20)
+            {
+                out += "\\u00";
+                out += hex[uch >> 4];
+                out += hex[uch & 0xf];
+            }
+            else
+            {
+                out += ch;
+            }
+        }
+        out += '"';
+    }
+
+    void format_text(std::string& out, const token& tok, bool& interpolated)
+    {
+        std::visit(overloaded {
+            [&](const token_indent& t) {
+                out += "indent { ";
+                append_number(out, t.level);
+                out += " }\n";
+            },
+            [&](const token_newline&) {
+                out += "newline {}\n";
+            },
+            [&](const token_punct& t) {
+                out.append("punct { '").append(u8view(t.str)).append("' }\n");
+            },
+            [&](const token_keyword& t) {
+                out.append("keyword { '").append(u8view(t.str)).append("' }\n");
+            },
+            [&](const token_contextual_keyword& t) {
+                out.append("contextual keyword { '").append(u8view(t.str)).append("' }\n");
+            },
+            [&](const token_identifier& t) {
+                out.append("identifier { '").append(u8view(t.str)).append("' }\n");
+            },
+            [&](const token_number& t) {
+                out += (t.is_float ? "float [radix:" : "integer [radix:");
+                append_number(out, t.radix);
+                out += "] { ";
+                if (t.is_float)
+                    append_number(out, t.floating);
+                else
+                    append_number(out, t.integer);
+                out.append(postfix_str(t.postfix)).append(" }\n");
+            },
+            [&](const token_normal_string& t) {
+                auto deli = static_cast<char>(t.delimiter);
+                out.append("normal string { ").append(1, deli).append(u8view(t.str)).append(1, deli).append(" }\n");
+            },
+            [&](const token_raw_string& t) {
+                auto deli = static_cast<char>(t.delimiter);
+                out.append("raw string { ").append(1, deli).append(u8view(t.str)).append(1, deli).append(" }\n");
+            },
+            [&](const token_interpol_string_start& t) {
+                out.append("interpolated string (start) { `").append(u8view(t.str)).append("{ }\n");
+                interpolated = true;
+            },
+            [&](const token_interpol_string_mid& t) {
+                out.append("interpolated string (mid) { }").append(u8view(t.str)).append("${ }\n");
+            },
+            [&](const token_interpol_string_end& t) {
+                out.append("interpolated string (end) { ").append(1, interpolated ? '}' : '`')
+                    .append(u8view(t.str)).append("` }\n");
+                interpolated = false;
+            },
+            [&](const token_error& t) {
+                out.append("error { ").append(t.message).append(" }\n");
+            },
+        }, tok.data);
+    }
+
+    void format_jsonl(std::string& out, const token& tok)
+    {
+        auto kind = [&](const char* name) {
+            out.append("{\"kind\":\"").append(name).append("\",\"beg\":[");
+            append_number(out, tok.beg.line + 1);
+            out += ',';
+            append_number(out, tok.beg.col + 1);
+            out += "],\"end\":[";
+            append_number(out, tok.end.line + 1);
+            out += ',';
+            append_number(out, tok.end.col + 1);
+            out += ']';
+        };
+        auto field = [&](const char* name, std::string_view str) {
+            out.append(",\"").append(name).append("\":");
+            append_json_string(out, str);
+        };
+
+        std::visit(overloaded {
+            [&](const token_indent& t) {
+                kind("indent");
+                out += ",\"level\":";
+                append_number(out, t.level);
+            },
+            [&](const token_newline&) {
+                kind("newline");
+            },
+            [&](const token_punct& t) {
+                kind("punct");
+                field("str", u8view(t.str));
+            },
+            [&](const token_keyword& t) {
+                kind("keyword");
+                field("str", u8view(t.str));
+            },
+            [&](const token_contextual_keyword& t) {
+                kind("contextual_keyword");
+                field("str", u8view(t.str));
+            },
+            [&](const token_identifier& t) {
+                kind("identifier");
+                field("str", u8view(t.str));
+            },
+            [&](const token_number& t) {
+                kind("number");
+                out += ",\"radix\":";
+                append_number(out, t.radix);
+                out += (t.is_float ? ",\"float\":true" : ",\"float\":false");
+                field("postfix", postfix_str(t.postfix));
+                out += ",\"value\":";
+                if (t.is_float)
+                    append_number(out, t.floating);
+                else
+                    append_number(out, t.integer);
+            },
+            [&](const token_normal_string& t) {
+                kind("normal_string");
+                field("delimiter", std::string(1, static_cast<char>(t.delimiter)));
+                field("str", u8view(t.str));
+            },
+            [&](const token_raw_string& t) {
+                kind("raw_string");
+                field("delimiter", std::string(1, static_cast<char>(t.delimiter)));
+                field("str", u8view(t.str));
+            },
+            [&](const token_interpol_string_start& t) {
+                kind("interpol_string_start");
+                field("str", u8view(t.str));
+            },
+            [&](const token_interpol_string_mid& t) {
+                kind("interpol_string_mid");
+                field("str", u8view(t.str));
+            },
+            [&](const token_interpol_string_end& t) {
+                kind("interpol_string_end");
+                field("str", u8view(t.str));
+            },
+            [&](const token_error& t) {
+                kind("error");
+                field("message", t.message);
+            },
+        }, tok.data);
+
+        out += "}\n";
+    }
+}
+
+void format_token(std::string& out, const token& tok, dump_format format, bool& interpolated)
+{
+    if (format == dump_format::text)
+        format_text(out, tok, interpolated);
+    else
+        format_jsonl(out, tok);
+}
+
+token_dumper::token_dumper(std::ostream& os, dump_format format)
+    : m_os(os), m_format(format), m_interpolated(false)
+{
+    m_buf.reserve(buffer_size + 4096);
+}
+
+token_dumper::~token_dumper()
+{
+    flush();
+}
+
+void token_dumper::beginFile(std::string_view name)
+{
+    m_interpolated = false;
+
+    if (m_format == dump_format::text)
+    {
+        m_buf.append("# ").append(name).append("\n");
+    }
+    else
+    {
+        m_buf += "{\"file\":";
+        append_json_string(m_buf, name);
+        m_buf += "}\n";
+    }
+}
+
+void token_dumper::dump(const token& tok)
+{
+    format_token(m_buf, tok, m_format, m_interpolated);
+
+    if (m_buf.size() >= buffer_size)
+        flush();
+}
+
+void token_dumper::flush()
+{
+    m_os.write(m_buf.data(), m_buf.size());
+    m_buf.clear();
+}
@@ -0,0 +1,62 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <ostream>
+
+#include "../libahafront/aha/front/lexer.hpp"
+
+enum class dump_format
+{
+    text,   // as the REPL prints
+    jsonl,  // a JSON object per line
+};
+
+// appends a token as a line of the format. interpolated tracks whether an interpolated
+// string is open, which the text format needs for the closing delimiter.
+void format_token(std::string& out, const aha::front::token& tok, dump_format format, bool& interpolated);
+
+// formats into a large buffer which is written to the stream in big chunks
+class token_dumper final
+{
+public:
+    token_dumper(const token_dumper&) = delete;
+    token_dumper& operator =(const token_dumper&) = delete;
+
+    token_dumper(std::ostream& os, dump_format format);
+    ~token_dumper();
+
+    // a header line before the tokens of each file
+    void beginFile(std::string_view name);
+    void dump(const aha::front::token& tok);
+
+    void flush();
+
+private:
+    std::ostream& m_os;
+    dump_format m_format;
+    std::string m_buf;
+    bool m_interpolated;
+};
@@ -0,0 +1,337 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "checks.h"
+
+#include <string_view>
+#include <sstream>
+#include <variant>
+#include <vector>
+
+#include "../libahafront/aha/front/source.hpp"
+#include "../libahafront/aha/front/lexer.hpp"
+#include "../libahafront/aha/front/diagnostics.hpp"
+#include "../libahafront/aha/front/parser.hpp"
+#include "../libahafront/aha/front/incremental.hpp"
+
+using namespace aha::front;
+
+namespace
+{
+    std::uint32_t next_random(std::uint32_t& state)
+    {
+        state = state * 1664525 + 1013904223;
+        return state >> 8;
+    }
+
+    std::string where(const source_position& pos)
+    {
+        return std::to_string(pos.line + 1) + ":" + std::to_string(pos.col + 1);
+    }
+
+    void describe_node(const ast& tree, node_id id, std::ostream& os)
+    {
+        auto& node = tree[id];
+        os << static_cast<int>(node.kind) << " " << static_cast<int>(node.flags) << " " << node.op << " "
+            << where(node.beg) << "-" << where(node.end) << " (";
+        for (auto child : tree.children(id))
+            describe_node(tree, child, os);
+        os << ")\n";
+    }
+
+    // the tree, tokens and errors of p, to be compared as a whole
+    std::string describe(const incremental_parser& p)
+    {
+        std::ostringstream os;
+
+        auto& tree = p.getModule();
+        describe_node(tree, tree.root(), os);
+
+        for (auto& tok : p.getTokens())
+            os << tok.data.index() << " " << where(tok.beg) << "-" << where(tok.end) << "\n";
+        for (auto& d : p.getLexerErrors())
+            os << "lexer error " << where(d.pos) << " " << d.message << "\n";
+        for (auto& d : p.getParserErrors())
+            os << "parser error " << where(d.pos) << " " << d.message << "\n";
+
+        return os.str();
+    }
+
+    // the number of code points of the line
+    unsigned line_length(std::string_view line)
+    {
+        unsigned count = 0;
+        for (unsigned char ch : line)
+            count += ((ch & 0xc0) != 0x80);
+        return count;
+    }
+
+    // overlong encodings, surrogates and code points beyond U+10FFFF are invalid byte sequences,
+    // while the code points at the edges of them decode
+    std::string utf8_is_strict(std::uint32_t)
+    {
+        struct valid_case
+        {
+            const char* bytes;
+            char32_t code_point;
+        };
+
+        const valid_case valid[] = {
+            { "\x7f", 0x7f },
+            { "\xc2\x80", 0x80 },
+            { "\xdf\xbf", 0x7ff },
+            { "\xe0\xa0\x80", 0x800 },
+            { "\xed\x9f\xbf", 0xd7ff },
+            { "\xee\x80\x80", 0xe000 },
+            { "\xef\xbf\xbf", 0xffff },
+            { "\xf0\x90\x80\x80", 0x10000 },
+            { "\xf4\x8f\xbf\xbf", 0x10ffff },
+        };
+
+        const char* const invalid[] = {
+            // overlong
+            "\xc0\x80",
+            "\xc1\xbf",
+            "\xe0\x80\x80",
+            "\xe0\x9f\xbf",
+            "\xf0\x80\x80\x80",
+            "\xf0\x8f\xbf\xbf",
+            // surrogates
+            "\xed\xa0\x80",
+            "\xed\xbf\xbf",
+            // beyond U+10FFFF
+            "\xf4\x90\x80\x80",
+            "\xf7\xbf\xbf\xbf",
+        };
+
+        auto hex = [](std::string_view bytes) {
+            std::ostringstream os;
+            os << std::hex;
+            for (unsigned char b : bytes)
+                os << "\\x" << static_cast<unsigned>(b);
+            return os.str();
+        };
+
+        for (auto& c : valid)
+        {
+            repl_source src("<check>");
+            src.feedString(c.bytes);
+            src.feedEof();
+
+            try
+            {
+                auto ch = src.readChar();
+                if (!ch || ch->first != c.code_point || src.readChar())
+                    return hex(c.bytes) + " does not decode to one code point " + std::to_string(c.code_point);
+            }
+            catch (invalid_byteseq&)
+            {
+                return hex(c.bytes) + " is rejected";
+            }
+        }
+
+        for (auto bytes : invalid)
+        {
+            repl_source src("<check>");
+            src.feedString(bytes);
+            src.feedEof();
+
+            try
+            {
+                src.readChar();
+                return hex(bytes) + " is accepted";
+            }
+            catch (invalid_byteseq&)
+            {
+            }
+        }
+
+        return { };
+    }
+
+    // a string literal broken by a newline is an error up to the newline, and the next line is lexed
+    // and parsed on its own
+    std::string string_error_ends_at_newline(std::uint32_t)
+    {
+        const char* const inputs[] = {
+            "let c = \"abc\nlet d = 1\n",
+            "let c = `abc\nlet d = 1\n",
+            "let c = `a ${c} b\nlet d = 1\n",
+            "let c = \"a\\q\nlet d = 1\n",
+        };
+
+        for (auto input : inputs)
+        {
+            repl_source src("<check>");
+            src.feedString(input);
+            src.feedEof();
+
+            lexer ll;
+            parser yy;
+            diagnostics diag;
+            diagnostics parse_diag;
+            ll.setDiagnostics(&diag);
+            yy.setDiagnostics(&parse_diag);
+
+            bool after_error = false;
+            while (auto tok = ll.lex(src))
+            {
+                if (after_error && !std::holds_alternative<token_newline>(tok->data))
+                    return "a token other than newline follows the error at " + where(tok->beg);
+
+                if (std::holds_alternative<token_error>(tok->data) && tok->end.line != 0)
+                    return "the error token ends at " + where(tok->end) + ", on the next line";
+
+                after_error = std::holds_alternative<token_error>(tok->data);
+                yy.parse(std::move(*tok));
+            }
+            yy.finish();
+
+            if (diag.empty())
+                return "no lexer error";
+            for (auto& d : parse_diag.get())
+            {
+                if (d.pos.line != 0)
+                    return "parser error on the next line at " + where(d.pos) + ": " + std::string(d.message);
+            }
+
+            auto& tree = yy.getModule();
+            auto items = tree.children(tree.root());
+            if (items.size() != 2 || tree.text(items[1]) != u8"d")
+                return "'let d = 1' is not a declaration of its own";
+        }
+
+        return { };
+    }
+
+    // random edits give the same tree, tokens and errors as parsing the edited text from the start
+    std::string incremental_matches_reset(std::uint32_t seed)
+    {
+        const char* const lines[] = {
+            "x = 1", "f(a, b)", "var y: int = a + b * 2", "while x:", "    x = x - 1", "if a:", "    g()",
+            "return a", "let z = [1, 2, 3]", "Console.println `a ${x} b`", "s = `p ${q(1)} r ${t} u`",
+            "s = `p ${q(1,", "    2)} r`", "s = @\"raw\"", "s = \"str\" # note",
+        };
+        const char* const pieces[] = {
+            "a", "1", " ", "(", ":", "\u00e9", "`", "${", "}", "\"", "@\"", "/*", "*/", " + 1", "\n        y = 3",
+        };
+
+        const char* const initial =
+            "import aha.core\n\n"
+            "class A:\n"
+            "    public func f(): int:\n"
+            "        x = 1\n"
+            "        s = `a ${x} b`\n"
+            "    public func g(a: int): int:\n"
+            "        a = a + 1\n"
+            "\n"
+            "class B:\n"
+            "    var q: int = 3\n"
+            "    public static func main(args: string): int:\n"
+            "        Console.println \"Hello\"\n";
+
+        // rounds from the initial text, since the text grows into noise
+        for (int round = 0; round < 16; ++round)
+        {
+            std::string text = initial;
+
+            incremental_parser p;
+            p.reset(text);
+
+            for (int iteration = 0; iteration < 250; ++iteration)
+            {
+                std::vector<std::string_view> text_lines;
+                for (std::size_t pos = 0; pos < text.size(); )
+                {
+                    auto end = std::min(text.find('\n', pos), text.size());
+                    text_lines.push_back(std::string_view(text).substr(pos, end - pos));
+                    pos = end + 1;
+                }
+                if (text_lines.empty())
+                    text_lines.push_back({ });
+
+                auto line = next_random(seed) % static_cast<unsigned>(text_lines.size());
+                auto length = line_length(text_lines[line]);
+                source_position beg { line, 0 }, end { line, 0 };
+                std::string insert;
+
+                switch (next_random(seed) % 4)
+                {
+                    case 0:
+                    {
+                        // a line before the line, as indented as it
+                        auto indent = text_lines[line].find_first_not_of(' ');
+                        insert = std::string(indent == std::string_view::npos ? 4 : indent, ' ')
+                            + lines[next_random(seed) % std::size(lines)] + "\n";
+                        break;
+                    }
+                    case 1:
+                        // the whole line
+                        if (line + 1 < text_lines.size())
+                            end = { line + 1, 0 };
+                        else
+                            end = { line, length };
+                        break;
+                    case 2:
+                        // a character replaced or a piece inserted
+                        beg.col = (length ? next_random(seed) % length : 0);
+                        end.col = beg.col + (length && next_random(seed) % 2);
+                        insert = pieces[next_random(seed) % std::size(pieces)];
+                        break;
+                    default:
+                        // one level more or less
+                        if (next_random(seed) % 2)
+                            insert = "    ";
+                        else if (text_lines[line].starts_with("    "))
+                            end.col = 4;
+                        break;
+                }
+
+                p.edit(beg, end, insert);
+                text = p.getText();
+
+                incremental_parser whole;
+                whole.reset(text);
+
+                if (describe(p) != describe(whole))
+                {
+                    return "round " + std::to_string(round) + ", edit " + std::to_string(iteration) + " at "
+                        + where(beg) + "-" + where(end) + (p.getLastReparse().full ? "" : " (reparsed in part)")
+                        + " differs from parsing the whole text";
+                }
+            }
+        }
+
+        return { };
+    }
+}
+
+namespace ahabench
+{
+    const check checks[] = {
+        { "utf-8 is strict", utf8_is_strict },
+        { "string error ends at newline", string_error_ends_at_newline },
+        { "incremental edits match reset", incremental_matches_reset },
+    };
+
+    const std::size_t checks_count = std::size(checks);
+}
@@ -0,0 +1,387 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "corpus.h"
+
+#include <string_view>
+#include <initializer_list>
+
+namespace
+{
+    class random
+    {
+    public:
+        explicit random(std::uint32_t seed)
+            : m_state(seed)
+        {
+        }
+
+        // in [0, n)
+        std::uint32_t below(std::uint32_t n)
+        {
+            m_state = m_state * 1664525 + 1013904223;
+            return (m_state >> 8) % n;
+        }
+
+        bool chance(std::uint32_t percent)
+        {
+            return below(100) < percent;
+        }
+
+        template <typename T, std::size_t N>
+        const T& pick(const T (&arr)[N])
+        {
+            return arr[below(N)];
+        }
+
+    private:
+        std::uint32_t m_state;
+    };
+
+    const char* const words[] = {
+        "value", "count", "index", "name", "buffer", "result", "item", "node", "left", "right",
+        "parent", "token", "source", "length", "offset", "total", "state", "args", "data", "key",
+    };
+
+    const char* const types[] = {
+        "int", "uint", "long", "string", "bool", "object", "byte", "List<int>", "Map<string, object>",
+    };
+
+    const char* const unicode_words[] = {
+        "변수", "결과", "길이", "이름", "값", "αριθμός", "μήκος", "значение", "индекс",
+        "名前", "長さ", "数据", "结果", "café", "naïve", "größe", "ñandú", "ĳssel",
+    };
+
+    const char* const binops[] = {
+        "+", "-", "*", "/", "%", "==", "!=", "<", ">", "<=", ">=", "&&", "||", "&", "^", "<<", ">>",
+    };
+
+    // elements of a braced list are evaluated in order, unlike the operands of +
+    std::string cat(std::initializer_list<std::string> parts)
+    {
+        std::string str;
+        for (auto& part : parts)
+            str += part;
+        return str;
+    }
+
+    std::string ident(random& rng)
+    {
+        std::string str = rng.pick(words);
+        if (rng.chance(40))
+            str += std::to_string(rng.below(100));
+        return str;
+    }
+
+    std::string unicode_ident(random& rng)
+    {
+        std::string str = rng.pick(unicode_words);
+        if (rng.chance(50))
+            str += cat({ "_", rng.pick(unicode_words) });
+        return str;
+    }
+
+    std::string number(random& rng)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string str;
+
+        auto append_digits = [&](unsigned radix, unsigned count) {
+            for (unsigned i = 0; i < count; ++i)
+                str += digits[rng.below(radix)];
+        };
+
+        switch (rng.below(8))
+        {
+            case 0:
+                str = "0b";
+                append_digits(2, 1 + rng.below(32));
+                break;
+            case 1:
+                str = "0c";
+                append_digits(8, 1 + rng.below(11));
+                break;
+            case 2:
+                str = "0d";
+                append_digits(10, 1 + rng.below(9));
+                break;
+            case 3:
+                str = "0x";
+                append_digits(16, 1 + rng.below(16));
+                break;
+            case 4:
+                str = std::to_string(rng.below(100000));
+                break;
+            case 5:
+                str = cat({ std::to_string(rng.below(1000)), ".", std::to_string(rng.below(1000)) });
+                if (rng.chance(50))
+                    str += cat({ "e", rng.chance(50) ? "-" : "", std::to_string(rng.below(30)) });
+                break;
+            case 6:
+                str = "0x";
+                append_digits(16, 1 + rng.below(6));
+                str += ".";
+                append_digits(16, 1 + rng.below(6));
+                str += "p" + std::to_string(rng.below(20));
+                break;
+            default:
+                str = cat({ std::to_string(rng.below(1000)), rng.pick({ "u", "l", "ul", "f" }) });
+                break;
+        }
+
+        return str;
+    }
+
+    std::string string_literal(random& rng, std::size_t length)
+    {
+        static const char* const pieces[] = {
+            "hello", " ", "world", ", ", "the quick brown fox", " jumps", "\\n", "\\t", "\\\"", "\\x41", "\\u00e9", "한글",
+        };
+
+        std::string str = "\"";
+        while (str.size() < length)
+            str += rng.pick(pieces);
+        return str + "\"";
+    }
+
+    std::string expression(random& rng, unsigned depth = 0)
+    {
+        if (depth >= 3 || rng.chance(30))
+            return rng.chance(60) ? ident(rng) : number(rng);
+
+        switch (rng.below(4))
+        {
+            case 0:
+                return cat({ "(", expression(rng, depth + 1), ")" });
+            case 1:
+                return cat({ ident(rng), "(", expression(rng, depth + 1), ", ", expression(rng, depth + 1), ")" });
+            case 2:
+                return cat({ ident(rng), "[", expression(rng, depth + 1), "]" });
+            default:
+                return cat({ expression(rng, depth + 1), " ", rng.pick(binops), " ", expression(rng, depth + 1) });
+        }
+    }
+
+    std::string interpolation(random& rng)
+    {
+        std::string str = "`";
+        for (unsigned i = 0, n = 1 + rng.below(4); i < n; ++i)
+            str += cat({ rng.pick(words), " ${", expression(rng, 1), "} " });
+        return str + "end`";
+    }
+
+    void line(std::string& out, unsigned level, std::string_view text)
+    {
+        out.append(level * 4, ' ');
+        out += text;
+        out += '\n';
+    }
+
+    std::string statement(random& rng)
+    {
+        switch (rng.below(6))
+        {
+            case 0:
+                return cat({ "let ", ident(rng), " = ", expression(rng) });
+            case 1:
+                return cat({ "var ", ident(rng), ": ", rng.pick(types), " = ", number(rng) });
+            case 2:
+                return cat({ ident(rng), " = ", string_literal(rng, 8 + rng.below(40)) });
+            case 3:
+                return "Console.println " + interpolation(rng);
+            case 4:
+                return cat({ ident(rng), ".", ident(rng), "(", expression(rng), ")" });
+            default:
+                return "return " + expression(rng);
+        }
+    }
+
+    // a class with a method to put the statements of a corpus in, at level 2
+    void open_method(std::string& out, random& rng, unsigned cls)
+    {
+        line(out, 0, "class Class" + std::to_string(cls) + ":");
+        line(out, 1, cat({ "public func ", ident(rng), "(", ident(rng), ": ", rng.pick(types), "): ", rng.pick(types), ":" }));
+    }
+
+    // classes with methods, as in ordinary code
+    std::string realistic(std::size_t size, std::uint32_t seed)
+    {
+        random rng(seed);
+        std::string out = "import aha.core\n\n";
+
+        for (unsigned cls = 0; out.size() < size; ++cls)
+        {
+            line(out, 0, "# generated class " + std::to_string(cls));
+            line(out, 0, "class Class" + std::to_string(cls) + ":");
+
+            for (unsigned i = 0, n = 1 + rng.below(6); i < n; ++i)
+            {
+                if (rng.chance(30))
+                    line(out, 1, cat({ "// ", ident(rng), " ", ident(rng) }));
+
+                line(out, 1, cat({ rng.pick({ "public", "private", "protected", "internal" }),
+                    " func ", ident(rng), "(", ident(rng), ": ", rng.pick(types), "): ", rng.pick(types), ":" }));
+
+                for (unsigned j = 0, m = 1 + rng.below(8); j < m; ++j)
+                    line(out, 2, statement(rng));
+
+                out += '\n';
+            }
+        }
+
+        return out;
+    }
+
+    // nested blocks that climb to a depth of 64 and back
+    std::string deep_indentation(std::size_t size, std::uint32_t seed)
+    {
+        random rng(seed);
+        std::string out;
+
+        for (unsigned cls = 0; out.size() < size; ++cls)
+        {
+            open_method(out, rng, cls);
+
+            unsigned depth = 16 + rng.below(49);
+            for (unsigned level = 0; level < depth; ++level)
+                line(out, level + 2, cat({ "block", std::to_string(level), " ", ident(rng), ":" }));
+            for (unsigned level = depth; level-- > 0; )
+                line(out, level + 3, statement(rng));
+        }
+
+        return out;
+    }
+
+    std::string unicode_identifiers(std::size_t size, std::uint32_t seed)
+    {
+        random rng(seed);
+        std::string out;
+
+        while (out.size() < size)
+        {
+            line(out, 0, cat({ "let ", unicode_ident(rng), " = ", unicode_ident(rng), " ",
+                rng.pick(binops), " ", unicode_ident(rng), ".", unicode_ident(rng), "(", number(rng), ")" }));
+        }
+
+        return out;
+    }
+
+    // literals of 1 to 16 KiB
+    std::string long_strings(std::size_t size, std::uint32_t seed)
+    {
+        random rng(seed);
+        std::string out;
+
+        while (out.size() < size)
+            line(out, 0, cat({ "let ", ident(rng), " = ", string_literal(rng, 1024 << rng.below(5)) }));
+
+        return out;
+    }
+
+    std::string interpolated_strings(std::size_t size, std::uint32_t seed)
+    {
+        random rng(seed);
+        std::string out;
+
+        for (unsigned cls = 0; out.size() < size; ++cls)
+        {
+            open_method(out, rng, cls);
+
+            for (unsigned i = 0; i < 32; ++i)
+                line(out, 2, "Console.println " + interpolation(rng));
+        }
+
+        return out;
+    }
+
+    // every radix, floats and postfixes
+    std::string numbers(std::size_t size, std::uint32_t seed)
+    {
+        random rng(seed);
+        std::string out;
+
+        while (out.size() < size)
+        {
+            std::string text = cat({ "let ", ident(rng), " = [" });
+            for (unsigned i = 0; i < 16; ++i)
+                text += (i ? ", " : "") + number(rng);
+            line(out, 0, text + "]");
+        }
+
+        return out;
+    }
+
+    // mostly comments of every kind, with some code between
+    std::string comment_heavy(std::size_t size, std::uint32_t seed)
+    {
+        random rng(seed);
+        std::string out;
+
+        for (unsigned cls = 0; out.size() < size; ++cls)
+        {
+            open_method(out, rng, cls);
+            // so that the body is not empty when only comments follow
+            line(out, 2, statement(rng));
+
+            for (unsigned i = 0; i < 32; ++i)
+            {
+                switch (rng.below(4))
+                {
+                    case 0:
+                        line(out, 2, cat({ "# ", ident(rng), " ", ident(rng), " ", ident(rng) }));
+                        break;
+                    case 1:
+                        line(out, 2, cat({ statement(rng), " // ", ident(rng), " ", unicode_ident(rng) }));
+                        break;
+                    case 2:
+                    {
+                        std::string text = "/*";
+                        for (unsigned j = 0, n = 1 + rng.below(8); j < n; ++j)
+                            text += cat({ " * ", ident(rng), " ", ident(rng), " ", unicode_ident(rng), "\n" });
+                        line(out, 2, text + " */");
+                        break;
+                    }
+                    default:
+                        line(out, 2, cat({ statement(rng), " /* ", ident(rng), " */" }));
+                        break;
+                }
+            }
+        }
+
+        return out;
+    }
+}
+
+namespace ahabench
+{
+    const corpus corpora[] = {
+        { "realistic", "realistic.aha", realistic },
+        { "deep indentation", "deep-indentation.aha", deep_indentation },
+        { "unicode identifiers", "unicode-identifiers.aha", unicode_identifiers },
+        { "long strings", "long-strings.aha", long_strings },
+        { "interpolated strings", "interpolated-strings.aha", interpolated_strings },
+        { "numbers", "numbers.aha", numbers },
+        { "comment heavy", "comment-heavy.aha", comment_heavy },
+    };
+
+    const std::size_t corpora_count = std::size(corpora);
+}
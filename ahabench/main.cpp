@@ -0,0 +1,466 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+
+#include <boost/program_options.hpp>
+namespace bpo = boost::program_options;
+
+#include "../libahafront/aha/front/source.hpp"
+#include "../libahafront/aha/front/lexer.hpp"
+#include "../libahafront/aha/front/diagnostics.hpp"
+#include "../libahafront/aha/front/parser.hpp"
+#include "../libahafront/aha/front/pipeline.hpp"
+#include "../libahafront/aha/front/push_lexer.hpp"
+
+#include "corpus.h"
+#include "checks.h"
+
+using namespace aha::front;
+
+namespace
+{
+    // adversarial inputs of about 'size' bytes
+    struct workload
+    {
+        const char* name;
+        std::string (*generate)(std::size_t size);
+    };
+
+    std::string repeat(std::string_view unit, std::size_t size)
+    {
+        std::string str;
+        str.reserve(size + unit.size());
+        while (str.size() < size)
+            str += unit;
+        return str;
+    }
+
+    std::uint32_t next_random(std::uint32_t& state)
+    {
+        state = state * 1664525 + 1013904223;
+        return state >> 8;
+    }
+
+    const workload workloads[] = {
+        { "raw string with escaped delimiters", [](std::size_t size) {
+            return "let s = @\"" + repeat("\"\"", size) + "\"\n";
+        } },
+        { "raw string with delimiter runs", [](std::size_t size) {
+            return "let s = @'" + repeat("a''''''b'''", size) + "'\n";
+        } },
+        { "string with escapes", [](std::size_t size) {
+            return "let s = \"" + repeat("\\n\\x41\\u00e9\\\"", size) + "\"\n";
+        } },
+        { "interpolated string with dollars", [](std::size_t size) {
+            return "let s = `" + repeat("$$a$", size) + "`\n";
+        } },
+        { "punctuator run", [](std::size_t size) {
+            static const char puncts[] = "~!$%^&*()-=+[];:,.<>?|";
+            std::uint32_t state = 1;
+            std::string str;
+            while (str.size() < size)
+                str += puncts[next_random(state) % (sizeof(puncts) - 1)];
+            return str + "\n";
+        } },
+        { "long identifier", [](std::size_t size) {
+            return repeat("abcdefgh", size) + "\n";
+        } },
+        { "long number", [](std::size_t size) {
+            return "0x" + repeat("0123456789abcdef", size) + ".8p1\n";
+        } },
+        { "deep indentation", [](std::size_t size) {
+            // climbs to depth about sqrt(size) and back, repeatedly
+            auto depth = static_cast<std::size_t>(std::sqrt(static_cast<double>(size)));
+            std::string str;
+            while (str.size() < size)
+            {
+                for (std::size_t i = 0; i <= depth; ++i)
+                    str += std::string(i, ' ') + "x\n";
+                for (std::size_t i = depth; i-- > 0; )
+                    str += std::string(i, ' ') + "x\n";
+            }
+            return str;
+        } },
+        { "CR-only newlines", [](std::size_t size) {
+            return repeat("a\r", size);
+        } },
+        { "blank lines", [](std::size_t size) {
+            return repeat("\n \n\t\n", size);
+        } },
+        { "block comment with stars", [](std::size_t size) {
+            return "/*" + repeat("* ** *** /", size) + "*/\n";
+        } },
+        { "line comments", [](std::size_t size) {
+            return repeat("# // /* */ \"unterminated\n", size);
+        } },
+        { "error storm", [](std::size_t size) {
+            return repeat("0x 1e 0b2 \"\\q\" 12zz ", size) + "\n";
+        } },
+    };
+
+    // seconds to lex the whole input, best of 'runs'
+    double measure(const std::string& input, int runs)
+    {
+        double best = 0;
+
+        for (int run = 0; run < runs; ++run)
+        {
+            repl_source src("<bench>");
+            lexer ll;
+            diagnostics diag;
+            ll.setDiagnostics(&diag);
+
+            auto beg = std::chrono::steady_clock::now();
+
+            src.feedString(input);
+            src.feedEof();
+
+            while (ll.lex(src))
+            {
+            }
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - beg;
+
+            if (run == 0 || elapsed.count() < best)
+                best = elapsed.count();
+        }
+
+        return best;
+    }
+
+    enum class stage
+    {
+        read_char,      // repl_source::readChar over the fed input
+        lex,            // lexer::lex over the fed input
+        end_to_end,     // feeding, lexing and parsing
+        pipelined,      // as end_to_end, but lexing on a thread of its own (parse_pipelined)
+        push_lex,       // feeding in chunks of 4 KiB and lexing, through push_lexer
+    };
+
+    const char* const stage_names[] = { "read_char", "lex", "end_to_end", "pipelined", "push_lex" };
+
+    struct stage_result
+    {
+        double seconds;
+        std::size_t items;      // characters for read_char, tokens otherwise
+    };
+
+    stage_result measure_stage(stage st, const std::string& input, int runs)
+    {
+        stage_result best { };
+
+        for (int run = 0; run < runs; ++run)
+        {
+            repl_source src("<bench>");
+            lexer ll;
+            parser yy;
+            diagnostics diag;
+            diagnostics parse_diag;
+            ll.setDiagnostics(&diag);
+            yy.setDiagnostics(&parse_diag);
+
+            std::size_t items = 0;
+
+            if (st == stage::read_char || st == stage::lex)
+            {
+                src.feedString(input);
+                src.feedEof();
+            }
+
+            auto beg = std::chrono::steady_clock::now();
+
+            switch (st)
+            {
+                case stage::read_char:
+                    while (src.readChar())
+                        ++items;
+                    break;
+
+                case stage::lex:
+                    while (ll.lex(src))
+                        ++items;
+                    break;
+
+                case stage::end_to_end:
+                    src.feedString(input);
+                    src.feedEof();
+                    while (auto tok = ll.lex(src))
+                    {
+                        yy.parse(*tok);
+                        ++items;
+                    }
+                    yy.finish();
+                    break;
+
+                case stage::pipelined:
+                    src.feedString(input);
+                    src.feedEof();
+                    items = parse_pipelined(src, ll, yy);
+                    break;
+
+                case stage::push_lex:
+                {
+                    push_lexer pl([&](token&&) { ++items; }, "<bench>");
+                    pl.getLexer().setDiagnostics(&diag);
+
+                    for (std::size_t pos = 0; pos < input.size(); pos += 4096)
+                        pl.feed(std::string_view(input).substr(pos, 4096));
+                    pl.feedEof();
+                    break;
+                }
+            }
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - beg;
+
+            if (run == 0 || elapsed.count() < best.seconds)
+                best = { elapsed.count(), items };
+        }
+
+        return best;
+    }
+
+    std::string json_string(std::string_view str)
+    {
+        std::string ret = "\"";
+        for (char ch : str)
+        {
+            if (ch == '"' || ch == '\\')
+            {
+                ret += '\\';
+                ret += ch;
+            }
+            else if (static_cast<unsigned char>(ch) < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                ret += buf;
+            }
+            else
+            {
+                ret += ch;
+            }
+        }
+        return ret + "\"";
+    }
+
+    int write_corpora(const std::filesystem::path& dir, std::size_t size, std::uint32_t seed)
+    {
+        std::filesystem::create_directories(dir);
+
+        for (std::size_t i = 0; i < ahabench::corpora_count; ++i)
+        {
+            auto& c = ahabench::corpora[i];
+            auto path = dir / c.file;
+
+            std::ofstream file(path, std::ios::binary);
+            file << c.generate(size, seed);
+            if (!file)
+            {
+                std::cerr << path.string() << ": cannot write\n";
+                return -1;
+            }
+
+            std::cout << path.string() << "\n";
+        }
+
+        return 0;
+    }
+
+    // MB/s and items/s of every stage over every corpus. the table goes to stderr if the JSON goes to stdout.
+    int run_throughput(std::size_t size, std::uint32_t seed, int runs, const std::string& json_path, const std::string& label)
+    {
+        auto& table = (json_path == "-" ? std::cerr : std::cout);
+        std::ostringstream json;
+        json << std::fixed << "{\n  \"label\": " << json_string(label) << ",\n  \"size\": " << size << ",\n  \"seed\": " << seed
+            << ",\n  \"runs\": " << runs << ",\n  \"corpora\": [";
+
+        for (std::size_t i = 0; i < ahabench::corpora_count; ++i)
+        {
+            auto& c = ahabench::corpora[i];
+            auto input = c.generate(size, seed);
+            double mb = input.size() / 1e6;
+
+            table << c.name << " (" << input.size() << " bytes):\n";
+            json << (i ? "," : "") << "\n    {\n      \"name\": " << json_string(c.name)
+                << ",\n      \"bytes\": " << input.size() << ",\n      \"stages\": {";
+
+            for (std::size_t j = 0; j < std::size(stage_names); ++j)
+            {
+                auto result = measure_stage(static_cast<stage>(j), input, runs);
+                auto per_second = result.items / result.seconds;
+                const char* unit = (j == 0 ? "chars" : "tokens");
+
+                table << "  " << std::left << std::setw(12) << stage_names[j] << std::right
+                    << std::fixed << std::setprecision(2) << std::setw(10) << mb / result.seconds << " MB/s  "
+                    << std::setprecision(0) << std::setw(12) << per_second << " " << unit << "/s\n";
+
+                json << (j ? "," : "") << "\n        \"" << stage_names[j] << "\": { \"seconds\": "
+                    << std::setprecision(6) << result.seconds << ", \"" << unit << "\": " << result.items
+                    << ", \"mb_per_s\": " << std::setprecision(3) << mb / result.seconds
+                    << ", \"" << unit << "_per_s\": " << std::setprecision(0) << per_second << " }";
+            }
+
+            json << "\n      }\n    }";
+        }
+
+        json << "\n  ]\n}\n";
+
+        if (json_path == "-")
+        {
+            std::cout << json.str();
+        }
+        else if (!json_path.empty())
+        {
+            std::ofstream file(json_path, std::ios::binary);
+            file << json.str();
+            if (!file)
+            {
+                std::cerr << json_path << ": cannot write\n";
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
+    // every regression check; 1 if any fails
+    int run_checks(std::uint32_t seed)
+    {
+        bool failed = false;
+
+        for (std::size_t i = 0; i < ahabench::checks_count; ++i)
+        {
+            auto& c = ahabench::checks[i];
+            auto problem = c.run(seed);
+            failed = failed || !problem.empty();
+
+            std::cout << c.name << ": " << (problem.empty() ? "ok" : problem) << "\n";
+        }
+
+        std::cout << (failed ? "FAILED\n" : "OK\n");
+        return failed ? 1 : 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bpo::options_description opt("Options:");
+    opt.add_options()
+        ("help,h", "Display this information")
+        ("size", bpo::value<std::size_t>()->default_value(1 << 20), "size of the smallest input in bytes")
+        ("steps", bpo::value<int>()->default_value(4), "number of input sizes, doubling each time (at least 2)")
+        ("runs", bpo::value<int>()->default_value(3), "number of runs per measurement")
+        ("max-exponent", bpo::value<double>()->default_value(1.3), "largest allowed k in time ~ size^k")
+        ("throughput", "measure throughput over generated corpora instead of checking the scaling; "
+            "prints a table to stdout, or to stderr with --json -")
+        ("seed", bpo::value<std::uint32_t>()->default_value(1), "seed of the corpus generator")
+        ("json", bpo::value<std::string>(), "write throughput results as JSON to the file ('-' for stdout, "
+            "which then carries only the JSON)")
+        ("label", bpo::value<std::string>()->default_value(""), "label recorded in the JSON, e.g. a commit id")
+        ("write-corpus", bpo::value<std::string>(), "write the generated corpora into the directory and exit")
+        ("check", "run the regression checks of the front end (randomized by --seed) instead of measuring")
+        ;
+
+    bpo::variables_map vm;
+
+    try
+    {
+        bpo::store(bpo::parse_command_line(argc, argv, opt), vm);
+        bpo::notify(vm);
+    }
+    catch (bpo::error& e)
+    {
+        std::cerr << e.what() << "\n\n" << opt << "\n";
+        return -1;
+    }
+
+    if (vm.count("help"))
+    {
+        std::cout << opt << "\n";
+        return 0;
+    }
+
+    auto size = vm["size"].as<std::size_t>();
+    auto steps = vm["steps"].as<int>();
+    auto runs = vm["runs"].as<int>();
+    auto max_exponent = vm["max-exponent"].as<double>();
+    auto seed = vm["seed"].as<std::uint32_t>();
+
+    if (vm.count("write-corpus"))
+        return write_corpora(vm["write-corpus"].as<std::string>(), size, seed);
+
+    if (vm.count("check"))
+        return run_checks(seed);
+
+    if (vm.count("throughput"))
+    {
+        auto json_path = vm.count("json") ? vm["json"].as<std::string>() : std::string();
+        return run_throughput(size, seed, runs, json_path, vm["label"].as<std::string>());
+    }
+
+    bool failed = false;
+
+    for (auto& w : workloads)
+    {
+        std::cout << w.name << ":\n";
+
+        // least-squares slope of log(time) over log(size); 1 for linear, 2 for quadratic
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+        for (int step = 0; step < steps; ++step)
+        {
+            auto input = w.generate(size << step);
+            auto seconds = measure(input, runs);
+
+            double x = std::log(static_cast<double>(input.size()));
+            double y = std::log(seconds);
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+
+            std::cout << "  " << std::setw(10) << input.size() << " bytes  "
+                << std::fixed << std::setprecision(4) << std::setw(9) << seconds << " s  "
+                << std::setprecision(2) << std::setw(8) << seconds * 1e9 / input.size() << " ns/byte\n";
+        }
+
+        double exponent = (steps * sxy - sx * sy) / (steps * sxx - sx * sx);
+        bool ok = (exponent <= max_exponent);
+        failed = failed || !ok;
+
+        std::cout << "  time ~ size^" << std::setprecision(2) << exponent << (ok ? "\n" : "  <- superlinear\n");
+    }
+
+    std::cout << (failed ? "FAILED: lexing time grows faster than input size\n" : "OK\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <vector>
+#include <span>
+#include <string_view>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+
+#include "source.hpp"
+#include "lexer.hpp"
+
+namespace aha::front
+{
+    using node_id = std::uint32_t;
+    constexpr node_id null_node = UINT32_MAX;
+
+    enum class node_kind : std::uint8_t
+    {
+        // a placeholder where the parser reported an error, or where an optional child is absent
+        error,
+        empty,
+
+        // declarations. children of a declaration with a body end with its members or block.
+        module,             // children: module_name, imports and declarations in order
+        module_name,        // module a.b; children: names
+        import,             // import a.b; children: names
+        class_decl,         // text: name; children: type parameters, then members
+        interface_decl,     // as class_decl
+        enum_decl,          // text: name; children: enumerators
+        enumerator,         // text: name
+        func_decl,          // text: name; children: params, return type (or empty), body (or empty)
+        field_decl,         // let/var member; text: name; children: type (or empty), initializer (or empty)
+        param,              // text: name; children: type
+        type_param,         // text: name
+
+        // types
+        type_name,          // text: name, possibly dotted; children: type arguments
+        type_array,         // children: element type
+
+        // statements
+        block,              // children: statements, or none while lazy; see parser::setLazyBodies()
+        variable,           // let/var; text: name; children: type (or empty), initializer (or empty)
+        expr_stmt,          // children: expression
+        block_stmt,         // an expression followed by an indented block, e.g. 'while x:'; children: expression, block
+
+        // expressions
+        name,               // text: name
+        number,             // see ast::number()
+        string,             // text: decoded content
+        interpolated,       // children: strings and expressions, alternating and starting with a string
+        array,              // children: elements
+        member,             // text: member name; children: object
+        call,               // children: callee, then arguments
+        index,              // children: object, index
+        assign,             // op: '=', a compound assignment or ':=:'; children: target, value
+        unary,              // op: prefix or postfix operator; children: operand
+        binary,             // op: operator; children: left, right
+        lambda,             // 'x => y'; op: '=>'; children: parameter, body
+    };
+
+    // flags of declarations
+    namespace modifier
+    {
+        constexpr std::uint8_t public_ = 1 << 0;
+        constexpr std::uint8_t private_ = 1 << 1;
+        constexpr std::uint8_t protected_ = 1 << 2;
+        constexpr std::uint8_t internal = 1 << 3;
+        constexpr std::uint8_t static_ = 1 << 4;
+        constexpr std::uint8_t final = 1 << 5;
+    }
+
+    // flags of other nodes
+    namespace node_flag
+    {
+        constexpr std::uint8_t mutable_ = 1 << 6;      // variable and field_decl declared with 'var'; beside modifiers
+        constexpr std::uint8_t raw = 1 << 0;           // string from a raw literal
+        constexpr std::uint8_t juxtaposed = 1 << 0;    // call written as 'f x' rather than 'f(x)'
+        constexpr std::uint8_t optional = 1 << 0;      // member access written as 'a?.b'
+        constexpr std::uint8_t postfix = 1 << 0;       // unary operator written after the operand
+        constexpr std::uint8_t lazy = 1 << 0;          // block whose statements are not parsed yet; see ast::lazyBody()
+    }
+
+    // the tokens of a function body that is not parsed yet
+    struct lazy_body
+    {
+        // indices into the tokens of the module, as they were given to the parser
+        std::uint32_t token_beg;
+        std::uint32_t token_end;
+        // of the statements
+        std::uint32_t level;
+    };
+
+    struct ast_node
+    {
+        node_kind kind;
+        std::uint8_t flags;
+        std::uint16_t op;           // operator of operator nodes
+
+        // range in ast::m_children
+        std::uint32_t children_beg;
+        std::uint32_t children_count;
+
+        // text or number, according to kind
+        std::uint32_t value;
+
+        source_position beg;
+        source_position end;
+    };
+
+    // syntax tree of a module. nodes refer to each other by 32-bit index, and the children of
+    // a node are a contiguous range of indices. a node is added after its children, so nodes are
+    // stored in post-order until an incremental reparse puts new children under old nodes.
+    // everything lives in a few arrays from one memory resource, and is freed at once with the ast.
+    class ast final
+    {
+    public:
+        ast(const ast&) = delete;
+        ast& operator =(const ast&) = delete;
+        ast(ast&&) noexcept = default;
+        // takes the memory resource of other as well, unlike pmr containers
+        ast& operator =(ast&& other) noexcept;
+
+        explicit ast(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+        ~ast();
+
+        void clear();
+
+        // the module node; null_node until set
+        node_id root() const;
+        void setRoot(node_id id);
+
+        std::size_t size() const;
+        const ast_node& operator [](node_id id) const;
+
+        std::span<const node_id> children(node_id id) const;
+        node_id child(node_id id, std::size_t idx) const;
+
+        // of nodes whose value is a text, e.g. names and strings
+        std::u8string_view text(node_id id) const;
+        // of number nodes
+        const token_number& number(node_id id) const;
+        // of lazy blocks
+        const lazy_body& lazyBody(node_id id) const;
+
+        // building; used by the parser
+        node_id add(node_kind kind, source_position beg, source_position end,
+            std::span<const node_id> children = { }, std::uint32_t value = 0, std::uint8_t flags = 0, std::uint16_t op = 0);
+        std::uint32_t addText(std::u8string_view text);
+        std::uint32_t addNumber(const token_number& num);
+        std::uint32_t addLazyBody(const lazy_body& body);
+        // gives a lazy block its statements
+        void setBody(node_id id, std::span<const node_id> children);
+
+        // appends the nodes of other except its root, which must be the last node as after
+        // parser::finish(). returns the id the first node of other gets; the other ids of other
+        // are shifted by the same amount. the token indices of lazy bodies are kept.
+        node_id append(const ast& other);
+
+        // editing; used by incremental_parser. replaced nodes and children stay in the arrays
+        // until the ast is cleared.
+        void setChildren(node_id id, std::span<const node_id> children);
+        void setRange(node_id id, source_position beg, source_position end);
+        // moves positions at from_line or later by delta lines, in the nodes of [first, last)
+        void shiftLines(node_id first, node_id last, unsigned from_line, int delta);
+
+    private:
+        struct text_ref
+        {
+            std::uint32_t offset;
+            std::uint32_t length;
+        };
+
+        std::pmr::vector<ast_node> m_nodes;
+        std::pmr::vector<node_id> m_children;
+        std::pmr::vector<text_ref> m_texts;
+        std::pmr::u8string m_text_data;
+        std::pmr::vector<token_number> m_numbers;
+        std::pmr::vector<lazy_body> m_lazy_bodies;
+
+        node_id m_root;
+    };
+}
@@ -0,0 +1,58 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "source.hpp"
+
+namespace aha::front
+{
+    struct diagnostic
+    {
+        source* ptr_src;
+        source_position pos;
+        std::string_view message;   // always points to a string literal
+    };
+
+    // collects errors instead of throwing them; see lexer::setDiagnostics()
+    class diagnostics final
+    {
+    public:
+        diagnostics(const diagnostics&) = delete;
+        diagnostics& operator =(const diagnostics&) = delete;
+
+        diagnostics();
+        ~diagnostics();
+
+        void report(source& src, source_position pos, std::string_view message);
+        void clear();
+
+        bool empty() const;
+        const std::vector<diagnostic>& get() const;
+
+    private:
+        std::vector<diagnostic> m_list;
+    };
+}
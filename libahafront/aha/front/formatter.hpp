@@ -0,0 +1,54 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+namespace aha::front
+{
+    struct format_options
+    {
+        unsigned indent_width = 4;
+        unsigned max_blank_lines = 1;
+    };
+
+    class format_error : public std::runtime_error
+    {
+    public:
+        explicit format_error(const std::string& msg)
+            : std::runtime_error(msg)
+        {
+        }
+    };
+
+    // reformats a whole source file:
+    //  - indentation becomes indent_width spaces per level
+    //  - blanks between tokens become a single space; adjacent tokens stay adjacent
+    //  - trailing blanks are removed, and runs of blank lines are limited to max_blank_lines
+    //  - comments and the text of tokens are kept as they are
+    // line endings are normalized to '\n'. throws format_error if the content does not lex,
+    // or if the output would not lex into the same tokens.
+    std::string format_source(std::string_view content, std::string name, const format_options& opts = { });
+}
@@ -0,0 +1,135 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#include "source.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "diagnostics.hpp"
+
+namespace aha::front
+{
+    // keeps the text, tokens and tree of one file for an editor. an edit reparses only the smallest
+    // indented block that encloses it: the statements of a block, the members of a class, or the
+    // top-level declarations around the edit. every other subtree is reused as it is.
+    class incremental_parser final
+    {
+    public:
+        struct reparse_info
+        {
+            bool full;              // the whole text was parsed
+            node_id container;      // the block, class or module whose lines were reparsed
+            unsigned first_line;    // the reparsed lines, after the edit
+            unsigned line_count;
+            std::size_t token_count;
+        };
+
+        incremental_parser(const incremental_parser&) = delete;
+        incremental_parser& operator =(const incremental_parser&) = delete;
+
+        explicit incremental_parser(std::string name = "<buffer>");
+        ~incremental_parser();
+
+        // parses the whole text
+        void reset(std::string_view text);
+
+        // replaces the text from beg to end with text. columns count code points, as in tokens.
+        // throws std::out_of_range if a position is outside the text.
+        void edit(source_position beg, source_position end, std::string_view text);
+
+        const std::string& getText() const;
+        const ast& getModule() const;
+
+        // tokens of the whole text, which do not refer to a source
+        std::span<const token> getTokens() const;
+        // the innermost node of each token. line breaks between items belong to their container.
+        std::span<const node_id> getTokenNodes() const;
+        // the innermost node of the token at pos, or null_node
+        node_id nodeAt(source_position pos) const;
+
+        // errors of the whole text, in the order of positions. ptr_src is null.
+        const std::vector<diagnostic>& getLexerErrors() const;
+        const std::vector<diagnostic>& getParserErrors() const;
+
+        const reparse_info& getLastReparse() const;
+
+    private:
+        // a container that may be reparsed for an edit; see edit()
+        struct region
+        {
+            node_id container = null_node;
+            unsigned level = 0;
+            std::size_t path_size = 0;                  // container is m_path[path_size - 1]
+            std::size_t first = 0, last = 0;            // items [first, last) are replaced
+            unsigned first_line = 0, last_line = 0;     // lines before the edit
+            std::u8string indent { };
+            std::vector<std::size_t> widths { };
+        };
+
+        void parseAll();
+        bool reparse(const region& reg, int delta, bool removed_comment);
+
+        std::span<const node_id> items(node_id container) const;
+        node_id nestedContainer(node_id item) const;
+        std::size_t tokenIndex(source_position pos) const;
+        bool startsLine(node_id item, unsigned level) const;
+        bool makeRegion(region& reg, source_position edit_beg, unsigned edit_last) const;
+
+        std::size_t byteOffset(source_position pos) const;
+        void replaceText(std::size_t beg, std::size_t end, std::string_view text);
+        std::string_view lineText(unsigned first, int last) const;
+
+        std::string m_name;
+        std::string m_text;
+        std::vector<std::size_t> m_lines;       // offset of each line in m_text
+
+        lexer m_lexer;
+        parser m_parser;
+        diagnostics m_lexer_diag;
+        diagnostics m_parser_diag;
+
+        ast m_tree;
+        std::vector<token> m_tokens;
+        std::vector<node_id> m_token_nodes;
+        std::vector<diagnostic> m_lexer_errors;
+        std::vector<diagnostic> m_parser_errors;
+
+        // containers from the root down to the edit, and the items between them
+        std::vector<node_id> m_path;
+
+        // replaced nodes stay in the tree; it is rebuilt when they outgrow the live ones
+        std::size_t m_full_size;
+
+        // an interpolated string goes on over a line break, so the lexer may begin a line in the
+        // middle of it. lines are not relexed on their own then, until the text is parsed in whole.
+        bool m_interpolation_spans_lines;
+
+        reparse_info m_last;
+    };
+}
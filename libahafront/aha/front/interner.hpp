@@ -0,0 +1,63 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string_view>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace aha::front
+{
+    using symbol_id = std::uint32_t;
+    constexpr symbol_id null_symbol = UINT32_MAX;
+
+    // maps texts to 32-bit symbols, which are equal if and only if their texts are. a text is stored
+    // once and lives as long as the interner. the interner is split into shards by hash: looking up
+    // a text already interned, and text(), take no lock, and adding a text locks only its shard.
+    // which symbol a text gets depends on the order texts are added in, so it differs between runs.
+    class string_interner final
+    {
+    public:
+        string_interner(const string_interner&) = delete;
+        string_interner& operator =(const string_interner&) = delete;
+
+        string_interner();
+        ~string_interner();
+
+        // shared by every lexer unless another one is set; lives until the program exits
+        static string_interner& global();
+
+        // throws std::length_error if a shard is full
+        symbol_id intern(std::u8string_view text);
+
+        std::u8string_view text(symbol_id sym) const;
+
+        // the number of symbols
+        std::size_t size() const;
+
+    private:
+        struct shard;
+        std::unique_ptr<shard[]> m_shards;
+    };
+}
@@ -27,10 +27,16 @@
 #include <vector>
 #include <deque>
 #include <optional>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <variant>
 #include <utility>
+#include <cstdint>
 
 #include "source.hpp"
+#include "diagnostics.hpp"
+#include "interner.hpp"
 
 namespace aha::front
 {
@@ -57,47 +63,67 @@ namespace aha::front
     };
     struct token_punct
     {
-        std::u32string str;
+        std::pmr::u8string str;
     };
     struct token_keyword
     {
-        std::u32string str;
+        std::pmr::u8string str;
     };
     struct token_contextual_keyword
     {
-        std::u32string str;
+        std::pmr::u8string str;
     };
+    // the text of an identifier or a string literal is interned; str is owned by the interner
     struct token_identifier
     {
-        std::u32string str;
+        symbol_id symbol;
+        std::u8string_view str;
     };
     struct token_normal_string
     {
-        char32_t delimiter;
-        std::u32string str;
+        char8_t delimiter;
+        symbol_id symbol;
+        std::u8string_view str;
     };
     struct token_raw_string
     {
-        char32_t delimiter;
-        std::u32string str;
+        char8_t delimiter;
+        symbol_id symbol;
+        std::u8string_view str;
     };
     struct token_interpol_string_start
     {
-        std::u32string str;
+        std::pmr::u8string str;
     };
     struct token_interpol_string_mid
     {
-        std::u32string str;
+        std::pmr::u8string str;
     };
     struct token_interpol_string_end
     {
-        std::u32string str;
+        std::pmr::u8string str;
     };
+    enum class number_postfix
+    {
+        none,
+        u, l, ul,   // uint, long, ulong
+        f, d        // float, double
+    };
+
     struct token_number
     {
         unsigned radix;
-        std::string integer, fraction, exponent, postfix;
         bool is_float;
+        number_postfix postfix;
+
+        std::uint64_t integer;  // if !is_float
+        double floating;        // if is_float; already rounded to float precision for 'f' postfix
+    };
+
+    // emitted in place of the erroneous input when diagnostics are collected
+    struct token_error
+    {
+        std::string_view message;
     };
 
     struct token
@@ -118,17 +144,29 @@ namespace aha::front
             token_interpol_string_start,
             token_interpol_string_mid,
             token_interpol_string_end,
-            token_number
+            token_number,
+            token_error
             > data;
+
+        // set only in trivia mode. comments and blanks between the previous token and this one are
+        // leading trivia, except that those at the end of a line are trailing trivia of the last token
+        // of the line. the text of the token itself is [leading_trivia.end, trailing_trivia.beg).
+        // comments on the last line are left out if there is no token on the line.
+        source_range leading_trivia { };
+        source_range trailing_trivia { };
     };
 
     class lexer final
     {
     public:
+        // bump this whenever the same input may produce different tokens
+        static constexpr std::uint32_t version = 1;
+
         lexer(const lexer&) = delete;
         lexer& operator =(const lexer&) = delete;
 
-        lexer();
+        // internal buffers, and tokens unless setTokenResource() is called, are allocated from resource
+        explicit lexer(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
         ~lexer();
 
         void clearBuffer();
@@ -139,7 +177,32 @@ namespace aha::front
 
         void enableInterpolatedBlockEnd(bool enable);
 
-        void setContextualKeyword(std::vector<std::u32string> keywords);
+        void setContextualKeyword(std::vector<std::u8string> keywords);
+        // the list can be shared by lexers on several threads
+        void setContextualKeyword(std::shared_ptr<const std::vector<std::u8string>> keywords);
+
+        // if set, errors are reported to diag and lexing goes on from the next seperator or newline.
+        // otherwise (default) lex() throws lexer_error.
+        void setDiagnostics(diagnostics* diag);
+
+        // fills the trivia ranges of tokens. since the trivia at the end of a line is known only
+        // when the newline is lexed, each token is returned one lex() call later than usual.
+        void enableTrivia(bool enable);
+
+        // counts tokens, errors and lexing time into stats, if not null
+        void setStats(front_stats* stats);
+
+        // strings of the tokens lexed from now on are allocated from resource, e.g. an arena per file.
+        // nullptr for the resource of the lexer.
+        void setTokenResource(std::pmr::memory_resource* resource);
+
+        // identifiers and string literals are interned to interner, which must outlive their tokens.
+        // nullptr (default) for string_interner::global().
+        void setInterner(string_interner* interner);
+
+        // for lexing from the middle of a file: goes on as if the last line was indented with indent,
+        // and widths are where the indentation of each level ends. call after clearAll().
+        void setIndentation(std::u8string_view indent, std::span<const std::size_t> widths);
 
     private:
         void init();
@@ -149,19 +212,30 @@ namespace aha::front
             indent,
             any,
             after_comment,
+            recover,
             error
         };
 
-        std::deque<char32_t> m_buf;
+        std::pmr::memory_resource* m_resource;
+        std::pmr::memory_resource* m_token_resource;
+        string_interner* m_interner;
+
+        std::pmr::deque<char32_t> m_buf;
         source_position m_buf_beg;
 
-        std::u32string m_str_token;
+        std::pmr::u8string m_str_token;
         source_position m_tok_beg;
 
+        // decoded content of string literal; m_str_token keeps only its opening delimiter
+        std::pmr::u8string m_str_payload;
+        std::size_t m_raw_delim_run;
+        char32_t m_escape_value;
+        int m_escape_digits;
+
         state m_state;
 
-        std::u32string m_indent_str;
-        std::vector<std::size_t> m_indent_pos;
+        std::pmr::u8string m_indent_str;
+        std::pmr::vector<std::size_t> m_indent_pos;
 
         struct
         {
@@ -180,9 +254,12 @@ namespace aha::front
             bool comment_block_contains_newline : 1;
             bool comment_block_might_closing : 1;
             bool commented_out : 1;
+            bool string_escape : 1;
+            bool interpol_dollar : 1;
 
             bool interpol_string_after : 1;
             bool enable_interpol_block_end : 1;
+            bool trivia : 1;
         } m_flags;
         
         int m_idx_float_sep;
@@ -191,7 +268,27 @@ namespace aha::front
 
         lex_result m_last_result;
 
-        std::vector<std::u32string> m_contextual_keywords;
+        std::shared_ptr<const std::vector<std::u8string>> m_contextual_keywords;
+
+        diagnostics* m_diagnostics;
+        source_position m_error_beg;
+        std::string_view m_error_msg;
+
+        // exact end of the previous token, and the token held back in trivia mode
+        source_position m_text_end;
+        std::optional<token> m_trivia_pending;
+
+        front_stats* m_stats;
+
+        std::optional<token> lexNext(source& src);
+        std::optional<token> lexToken(source& src);
+        std::pmr::u8string tokenString(std::u8string_view str) const;
+        std::pmr::u8string takePayload();
+        symbol_id takePayloadSymbol();
+        void rebuffer();
+        void scanRun(source& src);
+        void scanStringBody(source& src);
+        const char* feedEscape(char32_t ch);
 
         static bool isSeperator(char32_t ch);
         static bool isIdentifierFirstChar(char32_t ch);
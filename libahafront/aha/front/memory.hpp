@@ -0,0 +1,60 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+
+namespace aha::front
+{
+    // passes allocations through to the upstream resource and counts them. not synchronized,
+    // so give one to each thread, e.g. above a std::pmr::monotonic_buffer_resource per file.
+    class counting_resource final : public std::pmr::memory_resource
+    {
+    public:
+        explicit counting_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+        std::pmr::memory_resource* getUpstream() const;
+
+        std::uint64_t getAllocations() const;
+        std::uint64_t getAllocatedBytes() const;
+        // bytes allocated and not deallocated yet, and the most of them at once
+        std::size_t getLiveBytes() const;
+        std::size_t getPeakBytes() const;
+
+        void reset();
+
+    private:
+        virtual void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        virtual void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        std::pmr::memory_resource* m_upstream;
+
+        std::uint64_t m_allocations;
+        std::uint64_t m_allocated_bytes;
+        std::size_t m_live_bytes;
+        std::size_t m_peak_bytes;
+    };
+}
@@ -0,0 +1,150 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdint>
+
+#include "source.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "ast.hpp"
+#include "diagnostics.hpp"
+#include "thread_pool.hpp"
+#include "stats.hpp"
+#include "memory.hpp"
+
+namespace aha::front
+{
+    // a parsed module file. function bodies are left lazy by default (see parser::setLazyBodies()),
+    // so the tree is mostly the interface of the module; tokens are kept for parser::parseBody().
+    struct module_unit
+    {
+        std::filesystem::path path;
+        std::uint64_t content_hash;
+
+        // strings of the tokens and the tree are allocated from here, so it goes last
+        std::unique_ptr<counting_resource> memory;
+
+        std::unique_ptr<repl_source> src;
+        std::vector<token> tokens;
+        ast tree;
+
+        std::vector<diagnostic> lexer_errors;
+        std::vector<diagnostic> parser_errors;
+
+        // 'import a.b' as "a.b", in the order of the file
+        struct import_ref
+        {
+            std::string name;
+            source_position pos;
+        };
+        std::vector<import_ref> imports;
+    };
+
+    // an import which cannot be found or closes a cycle, or a file which cannot be loaded
+    struct import_error
+    {
+        std::filesystem::path path;
+        source_position pos;
+        std::string message;
+    };
+
+    // the modules reached from the files given to module_loader::load()
+    struct module_graph
+    {
+        // a module comes after the modules it imports, unless they import it back
+        std::vector<std::shared_ptr<const module_unit>> modules;
+        // indices into modules of what modules[i] imports, in the order of its imports
+        std::vector<std::vector<std::size_t>> imports;
+        // in the order of modules
+        std::vector<import_error> errors;
+    };
+
+    // loads files together with the modules they import. 'import a.b' is found as a/b.aha in the
+    // first search path that has it. modules are lexed and parsed on the pool as soon as an import
+    // reaches them, each once however many files import it. parsed modules are cached by path and
+    // content hash, so a later load() parses only the files that changed.
+    class module_loader final
+    {
+    public:
+        module_loader(const module_loader&) = delete;
+        module_loader& operator =(const module_loader&) = delete;
+
+        module_loader(thread_pool& pool, std::vector<std::filesystem::path> search_paths);
+        ~module_loader();
+
+        // the result is the same whatever order the pool runs the modules in.
+        // must not be called from a task of the pool, nor by two threads at once.
+        module_graph load(std::span<const std::filesystem::path> files);
+
+        // whether function bodies are left lazy (default). drops the cache.
+        void setLazyBodies(bool lazy);
+
+        // counts decoding and lexing of the modules parsed from now on into stats, at the end of each
+        // load(); modules taken from the cache are not counted again. nullptr to stop counting.
+        void setStats(front_stats* stats);
+
+        // modules lexed and parsed by the last load(), i.e. not taken from the cache
+        std::size_t getParsedCount() const;
+
+        void clearCache();
+
+    private:
+        struct worker
+        {
+            lexer ll;
+            parser yy;
+            diagnostics lexer_diag;
+            diagnostics parser_diag;
+            front_stats stats;
+        };
+        struct load_entry;
+        struct load_state;
+
+        std::size_t addModule(load_state& state, const std::filesystem::path& path);
+        void loadModule(load_state& state, load_entry& entry, unsigned worker);
+        std::shared_ptr<const module_unit> parseModule(const std::filesystem::path& path, std::string content,
+            std::uint64_t hash, worker& w);
+        std::filesystem::path findModule(const std::string& name) const;
+
+        thread_pool& m_pool;
+        std::vector<std::filesystem::path> m_search_paths;
+        std::vector<worker> m_workers;
+
+        std::mutex m_mutex;
+        std::unordered_map<std::string, std::shared_ptr<const module_unit>> m_cache;
+        std::size_t m_parsed;
+        front_stats* m_stats;
+    };
+
+    // the inputs which are not directories, and every *.aha file under the directories among them,
+    // sorted since directory order differs among file systems
+    std::vector<std::filesystem::path> collect_files(std::span<const std::string> inputs);
+}
@@ -22,23 +22,170 @@
 
 #pragma once
 
+#include <vector>
+#include <memory_resource>
+#include <cstddef>
+
 #include "lexer.hpp"
+#include "ast.hpp"
+#include "diagnostics.hpp"
 
 namespace aha::front
 {
-    class lexer;
+    class parser_error : public source_positional_error
+    {
+    public:
+        parser_error(source& src, source_position pos, const std::string& msg)
+            : source_positional_error(src, pos, "parser error: " + msg)
+        {
+        }
+    };
+
+    // the punctuator of ast_node::op of unary, binary, assign and lambda nodes
+    std::u8string_view operator_text(std::uint16_t op);
 
     class parser final
     {
     public:
+        // parentheses, brackets and type arguments may be nested this deep. deeper nesting is
+        // a syntax error, rather than a stack overflow.
+        static constexpr unsigned max_nesting = 1000;
+
         parser(const parser&) = delete;
         parser& operator =(const parser&) = delete;
 
         parser();
         ~parser();
 
+        // starts a new module, dropping the previous one
+        void clearAll();
+
+        // tokens are buffered until a top-level declaration is complete, which is known when
+        // the next line at indentation level 0 begins, or at finish().
         void parse(const token& tok);
+        void parse(token&& tok);
+
+        // ends the module and builds its node
+        void finish();
+
+        // the module; complete after finish()
+        const ast& getModule() const;
+        ast takeModule();
+
+        // the AST of modules started from now on is allocated from resource.
+        // nullptr for the default resource.
+        void setModuleResource(std::pmr::memory_resource* resource);
+
+        // if set, errors are reported to diag and the rest of the top-level declaration is skipped.
+        // otherwise (default) parse() and finish() throw parser_error.
+        void setDiagnostics(diagnostics* diag);
+
+        // if set, the body of a function or a method is not parsed but only skipped up to the next line
+        // at the level of the function. its block is added with node_flag::lazy and the range of its
+        // tokens, to be parsed by parseBody() when needed. errors in a body are found only then, and
+        // do not make the whole declaration an error node.
+        // the tokens given to parse() from clearAll() on must be kept for parseBody().
+        void setLazyBodies(bool lazy);
+
+        // parses a lazy block of tree, which the parser made from tokens. a syntax error in the body
+        // is handled as in parse(): thrown, or reported and the block gets one error node.
+        // the nodes are added to tree, so the body of a tree may be parsed in the background as long
+        // as nothing else uses the tree meanwhile.
+        void parseBody(ast& tree, node_id block, std::span<const token> tokens);
+
+        // for incremental_parser: parses tokens of whole lines as the items of a container at the level,
+        // i.e. top-level declarations of a module (level 0), members of a class or an interface, or
+        // statements of a block. the nodes are added to tree, and token_nodes (as many as tokens) gets
+        // the innermost node of each token, or null_node for line breaks between items.
+        // returns false if the lines are not such items. a syntax error is skipped only at level 0.
+        bool parseItems(ast& tree, std::span<const token> tokens, node_kind container, unsigned level,
+            std::vector<node_id>& items, std::span<node_id> token_nodes);
 
     private:
+        class syntax_error { };
+
+        // an operator whose right operand is not parsed yet
+        struct pending_operator
+        {
+            std::uint16_t op;
+            bool prefix;
+            source_position beg;
+        };
+
+        void flushDeclaration();
+        void parseDeclaration();
+        void parseTopLevelLines(std::vector<node_id>& items);
+
+        // cursor over m_tokens
+        const token* peek(std::size_t n = 0) const;
+        const token& next();
+        bool atLineEnd() const;
+        bool isPunct(const char8_t* str, std::size_t n = 0) const;
+        bool isKeyword(const char8_t* str, std::size_t n = 0) const;
+        bool isIdentifier(std::size_t n = 0) const;
+        void expectPunct(const char8_t* str, const char* msg);
+        void expectLineEnd();
+        [[noreturn]] void fail(const char* msg);
+        [[noreturn]] void fail(source_position pos, const char* msg);
+
+        // lines of a block
+        unsigned lineLevel();
+        void skipBlankLines();
+        template <typename Func>
+        void parseLines(unsigned level, Func func);
+
+        std::uint8_t parseModifiers();
+        node_id parseTopLevel();
+        node_id parseQualifiedName(node_kind kind);
+        node_id parseTypeDecl(node_kind kind, std::uint8_t modifiers, source_position beg, unsigned level);
+        node_id parseEnum(std::uint8_t modifiers, source_position beg, unsigned level);
+        node_id parseMember(unsigned level);
+        node_id parseFunc(std::uint8_t modifiers, source_position beg, node_id return_type, unsigned level);
+        node_id parseVariable(node_kind kind, std::uint8_t modifiers, source_position beg);
+        node_id parseBlock(unsigned level);
+        node_id skipBody(unsigned level);
+        node_id parseStatement(unsigned level);
+
+        node_id parseType();
+        void expectTypeClose();
+
+        node_id parseExpression();
+        node_id parsePostfix(bool juxtapose);
+        node_id parsePrimary();
+        node_id parseInterpolated();
+        bool startsPrimary() const;
+
+        node_id addNode(node_kind kind, source_position beg, std::size_t children_mark,
+            std::uint32_t value = 0, std::uint8_t flags = 0, std::uint16_t op = 0);
+        void addOperator(node_kind kind, source_position beg, std::size_t children_mark,
+            std::uint16_t op, std::uint8_t flags);
+        source_position lastEnd() const;
+        void mapTokens(node_id id, source_position beg);
+
+        std::vector<token> m_tokens;
+        std::size_t m_token_base;   // index of m_tokens[0] in the tokens of the module
+        std::size_t m_pos;
+        std::size_t m_decl_start;   // the first token of the top-level declaration being parsed
+        bool m_line_start;
+        bool m_split_shift;         // the first '>' of a '>>' closed a type argument list
+        unsigned m_interpol_depth;  // the rest of an interpolated string follows the expression
+        unsigned m_depth;           // nesting of expressions and type arguments being parsed
+
+        ast m_ast;
+        ast* m_tree;                // where nodes are added: m_ast, or the tree of parseItems() or parseBody()
+        std::pmr::memory_resource* m_module_resource;
+
+        // children of the nodes being parsed; each node takes the top of the stack
+        std::vector<node_id> m_stack;
+        std::vector<pending_operator> m_ops;
+        std::vector<node_id> m_decls;
+
+        diagnostics* m_diagnostics;
+        bool m_lazy_bodies;
+
+        // token-to-node mapping of parseItems(). m_unmapped[i + 1] leads to the nearest token
+        // at or before i that has no node yet, or to 0.
+        node_id* m_token_nodes;
+        std::vector<std::size_t> m_unmapped;
     };
 }
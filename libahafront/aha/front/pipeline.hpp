@@ -0,0 +1,53 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <span>
+#include <memory_resource>
+#include <cstddef>
+
+#include "source.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "ast.hpp"
+#include "diagnostics.hpp"
+#include "thread_pool.hpp"
+
+namespace aha::front
+{
+    // lexes src on a worker thread and parses on the calling thread, connected by a bounded token queue.
+    // src must already be fed up to EOF. the module is finished (see parser::finish()), so
+    // yy.takeModule() gives the whole tree. an exception from either side is rethrown here
+    // after both threads have stopped. returns the number of tokens parsed.
+    std::size_t parse_pipelined(source& src, lexer& ll, parser& yy, std::size_t queue_capacity = 4096);
+
+    // parses the tokens of a whole module on the pool. the tokens are split where a line at level 0
+    // begins, i.e. between top-level declarations, and each part is parsed by a parser of its own
+    // into an arena of its own. the parts are appended in the order of the tokens, so the tree and
+    // the errors are the same as those of one parser fed with the tokens.
+    // errors are reported to diag if it is set; otherwise the first one is thrown as parser_error.
+    // the tree is allocated from resource (nullptr for the default resource).
+    // must not be called from a task of the pool.
+    ast parse_parallel(std::span<const token> tokens, thread_pool& pool,
+        diagnostics* diag = nullptr, std::pmr::memory_resource* resource = nullptr);
+}
@@ -0,0 +1,68 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <memory_resource>
+
+#include "source.hpp"
+#include "lexer.hpp"
+
+namespace aha::front
+{
+    // push-style front of lexer: the caller feeds byte chunks as they arrive,
+    // and every token completed by a chunk is handed to the sink before feed() returns.
+    // a token split across chunks is carried over by the lexer itself.
+    class push_lexer final
+    {
+    public:
+        using sink_type = std::function<void(token&& tok)>;
+
+        push_lexer(const push_lexer&) = delete;
+        push_lexer& operator =(const push_lexer&) = delete;
+
+        // the source, the lexer and the tokens allocate from resource
+        explicit push_lexer(sink_type sink, std::string name = "<stream>",
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+        ~push_lexer();
+
+        // tokens keep a pointer to this source
+        source& getSource();
+        lexer& getLexer();
+
+        // throws lexer_error unless diagnostics are set on getLexer()
+        void feed(std::string_view chunk);
+        void feedEof();
+
+        bool isEof() const;
+
+    private:
+        void drain();
+
+        repl_source m_src;
+        lexer m_lexer;
+        sink_type m_sink;
+    };
+}
@@ -27,11 +27,13 @@
 #include <vector>
 #include <deque>
 #include <optional>
+#include <memory_resource>
 #include <stdexcept>
 
 namespace aha::front
 {
     class source;
+    struct front_stats;
 
     struct source_position
     {
@@ -42,6 +44,13 @@ namespace aha::front
         source_position prev(source& src) const;
     };
 
+    // [beg, end)
+    struct source_range
+    {
+        source_position beg;
+        source_position end;
+    };
+
     class source_positional_error : public std::runtime_error
     {
     public:
@@ -96,12 +105,19 @@ namespace aha::front
         virtual char32_t getChar(source_position pos) const = 0;
         virtual unsigned getLineSize(unsigned line) const = 0;
         virtual source_position getEndpoint() const = 0;
+
+        // bulk access for the fast paths of the lexer.
+        // peekBytes() returns the input which is not read yet, and skipBytes() consumes its first 'count' bytes
+        // as characters. the consumed bytes must be ASCII characters and must not contain any newline.
+        virtual std::string_view peekBytes() const = 0;
+        virtual void skipBytes(std::size_t count) = 0;
     };
 
     class repl_source final : public source
     {
     public:
-        explicit repl_source(std::string name = "<stdin>");
+        // the characters are kept in memory from resource
+        explicit repl_source(std::string name = "<stdin>", std::pmr::memory_resource* resource = std::pmr::get_default_resource());
         virtual ~repl_source();
 
         void clearBuffer();
@@ -110,6 +126,9 @@ namespace aha::front
         void feedString(std::string_view line);
         void feedEof();
 
+        // counts decoded input into stats, if not null
+        void setStats(front_stats* stats);
+
         virtual std::string_view getName() override;
 
         virtual std::optional<std::pair<char32_t, source_position>> readChar() override;
@@ -119,19 +138,25 @@ namespace aha::front
         virtual unsigned getLineSize(unsigned line) const override;
         virtual source_position getEndpoint() const override;
 
+        virtual std::string_view peekBytes() const override;
+        virtual void skipBytes(std::size_t count) override;
+
     private:
         void init();
+        std::optional<std::pair<char32_t, source_position>> decodeChar();
+        void copyBytes(std::size_t count);
 
         std::string m_name;
 
-        std::deque<char32_t> m_chars;
-        std::vector<unsigned> m_lines;
+        std::pmr::deque<char32_t> m_chars;
+        std::pmr::vector<unsigned> m_lines;
         bool m_prev_is_CR;
 
-        std::deque<char> m_input;
+        std::pmr::string m_input;
+        std::size_t m_input_pos;
         bool m_input_end;
         bool m_error;
 
-        bool popByte(unsigned char& ch);
+        front_stats* m_stats;
     };
 }
@@ -0,0 +1,78 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <iosfwd>
+#include <variant>
+#include <cstdint>
+#include <cstddef>
+
+#include "lexer.hpp"
+
+namespace aha::front
+{
+    // counters of the repl_source and lexer given this by setStats(). not synchronized; use one per thread
+    // and merge them. the library is built with the counters unless AHA_FRONT_STATS is defined as 0.
+    struct front_stats
+    {
+        static constexpr std::size_t token_kinds = std::variant_size_v<decltype(token::data)>;
+
+        std::uint64_t bytes_decoded = 0;
+        std::uint64_t code_points = 0;
+        std::uint64_t rebuffered_chars = 0;
+        std::uint64_t errors = 0;
+        std::size_t peak_token_buffer = 0;          // longest m_str_token or string payload, in bytes
+
+        std::array<std::uint64_t, token_kinds> tokens { };
+        std::vector<std::uint64_t> indent_levels;   // indent tokens by level
+
+        // one read and one lex() in 64 are timed, since timing every call costs more than the call.
+        // the times are of the timed calls only; see decodeTime() and lexTime().
+        std::chrono::nanoseconds decode_time { };
+        std::chrono::nanoseconds lex_time { };
+        std::uint64_t reads = 0, timed_reads = 0;
+        std::uint64_t lex_calls = 0, timed_lex_calls = 0;
+
+        // not counted by the library; the owner of the memory resources fills these, e.g. from a counting_resource
+        std::uint64_t allocations = 0;
+        std::uint64_t allocated_bytes = 0;
+
+        // whether the library counts anything
+        static bool enabled();
+        static const char* tokenKindName(std::size_t kind);
+
+        std::uint64_t totalTokens() const;
+
+        // estimated from the timed calls. lexing time leaves out the decoding done during lex(),
+        // and is never below 0 though both are estimates.
+        std::chrono::nanoseconds decodeTime() const;
+        std::chrono::nanoseconds lexTime() const;
+        void merge(const front_stats& other);
+
+        void print(std::ostream& os) const;
+        void printJson(std::ostream& os) const;
+    };
+}
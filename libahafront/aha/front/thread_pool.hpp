@@ -0,0 +1,86 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstddef>
+
+namespace aha::front
+{
+    // work-stealing thread pool. every worker has its own task queue: it takes the newest task
+    // from its own queue, and when that is empty, steals the oldest one from another worker.
+    // tasks get the index of the worker which runs them, so that per-worker state
+    // (e.g. a lexer) can be kept in an array of size().
+    class thread_pool final
+    {
+    public:
+        using task_type = std::function<void(unsigned worker)>;
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator =(const thread_pool&) = delete;
+
+        // 0 for the number of hardware threads
+        explicit thread_pool(unsigned threads = 0);
+        // runs the remaining tasks before returning
+        ~thread_pool();
+
+        unsigned size() const;
+
+        // from a task, the new task goes to the queue of the current worker
+        void submit(task_type task);
+
+        // blocks until every submitted task is done, then rethrows the first exception
+        // thrown by a task, if any. must not be called from a task.
+        void wait();
+
+    private:
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<task_type> tasks;
+        };
+
+        void run(unsigned worker);
+        bool tryTake(unsigned worker, task_type& task);
+
+        std::vector<std::unique_ptr<worker_queue>> m_queues;
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv_work;
+        std::condition_variable m_cv_idle;
+        std::ptrdiff_t m_queued;    // may go below 0 for a moment, since a task can be taken before it is counted
+        std::size_t m_unfinished;
+        bool m_stop;
+        std::exception_ptr m_error;
+
+        unsigned m_next_queue;
+    };
+}
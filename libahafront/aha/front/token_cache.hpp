@@ -0,0 +1,134 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <span>
+#include <optional>
+#include <memory>
+#include <filesystem>
+#include <cstdint>
+
+#include "lexer.hpp"
+
+namespace aha::front
+{
+    // binary token stream:
+    //   token_stream_header
+    //   token_record[token_count]
+    //   string table (string_table_size bytes of UTF-8)
+    // every field is in native byte order, so a stream is only meaningful on the machine which wrote it.
+
+    struct token_stream_header
+    {
+        char magic[8];
+        std::uint32_t format_version;
+        std::uint32_t lexer_version;
+        std::uint64_t source_hash;
+        std::uint64_t source_size;
+        std::uint64_t token_count;
+        std::uint64_t string_table_size;
+    };
+
+    struct token_record
+    {
+        std::uint32_t kind;     // index of the alternative in token::data
+        std::uint32_t aux;      // indent level, string delimiter, or radix | postfix << 8 | is_float << 16
+        source_position beg;
+        source_position end;
+        std::uint32_t str_offset;
+        std::uint32_t str_size;
+        std::uint64_t value;    // integer, or bit pattern of floating
+    };
+
+    class token_stream_error : public std::runtime_error
+    {
+    public:
+        explicit token_stream_error(const std::string& msg)
+            : std::runtime_error("token stream error: " + msg)
+        {
+        }
+    };
+
+    // FNV-1a; pass the previous result as seed to hash several pieces
+    std::uint64_t hash_source(std::string_view content, std::uint64_t seed = 0xcbf29ce484222325);
+
+    // returns false if the tokens cannot be stored, e.g. they contain token_error
+    bool write_token_stream(const std::filesystem::path& path,
+        std::uint64_t source_hash, std::uint64_t source_size, std::span<const token> tokens);
+
+    // read-only mapping of a token stream file. records are used in place.
+    class token_stream_view final
+    {
+    public:
+        token_stream_view(const token_stream_view&) = delete;
+        token_stream_view& operator =(const token_stream_view&) = delete;
+
+        explicit token_stream_view(const std::filesystem::path& path);
+        token_stream_view(token_stream_view&& other) noexcept;
+        token_stream_view& operator =(token_stream_view&& other) noexcept;
+        ~token_stream_view();
+
+        const token_stream_header& getHeader() const;
+
+        std::size_t size() const;
+        const token_record* begin() const;
+        const token_record* end() const;
+        const token_record& operator [](std::size_t idx) const;
+
+        std::u8string_view getString(const token_record& rec) const;
+        // strings of the token are allocated from resource, or interned to interner
+        // (nullptr for string_interner::global())
+        token makeToken(const token_record& rec, source& src,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource(), string_interner* interner = nullptr) const;
+
+    private:
+        struct mapping;
+        std::unique_ptr<mapping> m_mapping;
+
+        const token_stream_header* m_header;
+        const token_record* m_records;
+        const char8_t* m_strings;
+    };
+
+    // directory of token streams keyed by source hash and lexer::version.
+    // lexer settings which change the output (e.g. contextual keywords) must be folded into the hash.
+    class token_cache final
+    {
+    public:
+        token_cache(const token_cache&) = delete;
+        token_cache& operator =(const token_cache&) = delete;
+
+        explicit token_cache(std::filesystem::path dir);
+        ~token_cache();
+
+        std::optional<token_stream_view> find(std::uint64_t source_hash, std::uint64_t source_size) const;
+        bool store(std::uint64_t source_hash, std::uint64_t source_size, std::span<const token> tokens) const;
+
+    private:
+        std::filesystem::path getPath(std::uint64_t source_hash) const;
+
+        std::filesystem::path m_dir;
+    };
+}
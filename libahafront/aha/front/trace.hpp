@@ -0,0 +1,79 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <iosfwd>
+#include <type_traits>
+
+namespace aha::front
+{
+    // records spans as Chrome trace events (viewable in Perfetto or chrome://tracing).
+    // every thread appends to a buffer of its own, so tracing does not serialize the threads.
+    class tracer final
+    {
+    public:
+        tracer() = delete;
+
+        // spans are recorded only while enabled (default: disabled)
+        static void enable(bool enable);
+        static bool enabled();
+
+        // drops all recorded spans
+        static void clear();
+
+        // trace-event JSON of the spans recorded so far; spans still open are left out
+        static void writeJson(std::ostream& os);
+    };
+
+    // records a span from construction to destruction, if the tracer is enabled at construction.
+    // name must outlive the tracer, e.g. a string literal. detail is copied only if the tracer is enabled;
+    // a detail which has to be built, e.g. from a path, is passed as a function which returns it.
+    class trace_span final
+    {
+    public:
+        trace_span(const trace_span&) = delete;
+        trace_span& operator =(const trace_span&) = delete;
+
+        explicit trace_span(const char* name, std::string_view detail = { });
+
+        template <typename Func, std::enable_if_t<std::is_invocable_r_v<std::string, Func&>, int> = 0>
+        trace_span(const char* name, Func&& detail)
+            : m_name(nullptr)
+        {
+            if (tracer::enabled())
+                start(name, detail());
+        }
+
+        ~trace_span();
+
+    private:
+        void start(const char* name, std::string detail);
+
+        const char* m_name;
+        std::string m_detail;
+        std::chrono::steady_clock::time_point m_beg;
+    };
+}
@@ -0,0 +1,260 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/ast.hpp"
+
+#include <memory>
+
+namespace
+{
+    using namespace aha::front;
+
+    // whether ast_node::value of the kind refers to a text; see node_kind
+    bool has_text(node_kind kind)
+    {
+        switch (kind)
+        {
+        case node_kind::class_decl:
+        case node_kind::interface_decl:
+        case node_kind::enum_decl:
+        case node_kind::enumerator:
+        case node_kind::func_decl:
+        case node_kind::field_decl:
+        case node_kind::param:
+        case node_kind::type_param:
+        case node_kind::type_name:
+        case node_kind::variable:
+        case node_kind::name:
+        case node_kind::string:
+        case node_kind::member:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+namespace aha::front
+{
+    ast::ast(std::pmr::memory_resource* resource)
+        : m_nodes(resource), m_children(resource), m_texts(resource), m_text_data(resource), m_numbers(resource), m_lazy_bodies(resource)
+        , m_root(null_node)
+    {
+    }
+
+    ast::~ast() = default;
+
+    ast& ast::operator =(ast&& other) noexcept
+    {
+        if (this != &other)
+        {
+            std::destroy_at(this);
+            std::construct_at(this, std::move(other));
+        }
+        return *this;
+    }
+
+    void ast::clear()
+    {
+        m_nodes.clear();
+        m_children.clear();
+        m_texts.clear();
+        m_text_data.clear();
+        m_numbers.clear();
+        m_lazy_bodies.clear();
+        m_root = null_node;
+    }
+
+    node_id ast::root() const
+    {
+        return m_root;
+    }
+
+    void ast::setRoot(node_id id)
+    {
+        m_root = id;
+    }
+
+    std::size_t ast::size() const
+    {
+        return m_nodes.size();
+    }
+
+    const ast_node& ast::operator [](node_id id) const
+    {
+        return m_nodes[id];
+    }
+
+    std::span<const node_id> ast::children(node_id id) const
+    {
+        auto& node = m_nodes[id];
+        return { m_children.data() + node.children_beg, node.children_count };
+    }
+
+    node_id ast::child(node_id id, std::size_t idx) const
+    {
+        auto& node = m_nodes[id];
+        if (idx >= node.children_count)
+            throw std::out_of_range("child index is out of range");
+
+        return m_children[node.children_beg + idx];
+    }
+
+    std::u8string_view ast::text(node_id id) const
+    {
+        auto& ref = m_texts[m_nodes[id].value];
+        return std::u8string_view(m_text_data).substr(ref.offset, ref.length);
+    }
+
+    const token_number& ast::number(node_id id) const
+    {
+        return m_numbers[m_nodes[id].value];
+    }
+
+    const lazy_body& ast::lazyBody(node_id id) const
+    {
+        assert(m_nodes[id].kind == node_kind::block && (m_nodes[id].flags & node_flag::lazy));
+        return m_lazy_bodies[m_nodes[id].value];
+    }
+
+    node_id ast::add(node_kind kind, source_position beg, source_position end,
+        std::span<const node_id> children, std::uint32_t value, std::uint8_t flags, std::uint16_t op)
+    {
+        if (m_nodes.size() >= null_node || m_children.size() + children.size() > UINT32_MAX)
+            throw std::length_error("too many nodes in a module");
+
+        auto children_beg = static_cast<std::uint32_t>(m_children.size());
+        m_children.insert(m_children.end(), children.begin(), children.end());
+
+        m_nodes.push_back({ kind, flags, op, children_beg, static_cast<std::uint32_t>(children.size()), value, beg, end });
+        return static_cast<node_id>(m_nodes.size() - 1);
+    }
+
+    std::uint32_t ast::addText(std::u8string_view text)
+    {
+        if (m_text_data.size() + text.size() > UINT32_MAX)
+            throw std::length_error("too much text in a module");
+
+        m_texts.push_back({ static_cast<std::uint32_t>(m_text_data.size()), static_cast<std::uint32_t>(text.size()) });
+        m_text_data += text;
+        return static_cast<std::uint32_t>(m_texts.size() - 1);
+    }
+
+    std::uint32_t ast::addNumber(const token_number& num)
+    {
+        m_numbers.push_back(num);
+        return static_cast<std::uint32_t>(m_numbers.size() - 1);
+    }
+
+    std::uint32_t ast::addLazyBody(const lazy_body& body)
+    {
+        m_lazy_bodies.push_back(body);
+        return static_cast<std::uint32_t>(m_lazy_bodies.size() - 1);
+    }
+
+    void ast::setBody(node_id id, std::span<const node_id> children)
+    {
+        assert(m_nodes[id].kind == node_kind::block && (m_nodes[id].flags & node_flag::lazy));
+
+        setChildren(id, children);
+        m_nodes[id].flags &= ~node_flag::lazy;
+        m_nodes[id].value = 0;
+    }
+
+    node_id ast::append(const ast& other)
+    {
+        assert(other.m_root != null_node && other.m_root == other.m_nodes.size() - 1);
+
+        // the children of the root are added last, with the root
+        auto node_count = other.m_nodes.size() - 1;
+        auto children_count = other.m_nodes.back().children_beg;
+
+        if (m_nodes.size() + node_count >= null_node || m_children.size() + children_count > UINT32_MAX)
+            throw std::length_error("too many nodes in a module");
+        if (m_text_data.size() + other.m_text_data.size() > UINT32_MAX)
+            throw std::length_error("too much text in a module");
+
+        auto node_offset = static_cast<node_id>(m_nodes.size());
+        auto children_offset = static_cast<std::uint32_t>(m_children.size());
+        auto text_offset = static_cast<std::uint32_t>(m_texts.size());
+        auto data_offset = static_cast<std::uint32_t>(m_text_data.size());
+        auto number_offset = static_cast<std::uint32_t>(m_numbers.size());
+        auto lazy_offset = static_cast<std::uint32_t>(m_lazy_bodies.size());
+
+        m_nodes.reserve(m_nodes.size() + node_count);
+        for (auto it = other.m_nodes.begin(); it != other.m_nodes.end() - 1; ++it)
+        {
+            auto& node = m_nodes.emplace_back(*it);
+            node.children_beg += children_offset;
+
+            if (node.kind == node_kind::number)
+                node.value += number_offset;
+            else if (has_text(node.kind))
+                node.value += text_offset;
+            else if (node.kind == node_kind::block && (node.flags & node_flag::lazy))
+                node.value += lazy_offset;
+        }
+
+        m_children.reserve(m_children.size() + children_count);
+        for (auto it = other.m_children.begin(); it != other.m_children.begin() + children_count; ++it)
+            m_children.push_back(*it + node_offset);
+
+        m_texts.reserve(m_texts.size() + other.m_texts.size());
+        for (auto& ref : other.m_texts)
+            m_texts.push_back({ ref.offset + data_offset, ref.length });
+
+        m_text_data += other.m_text_data;
+        m_numbers.insert(m_numbers.end(), other.m_numbers.begin(), other.m_numbers.end());
+        m_lazy_bodies.insert(m_lazy_bodies.end(), other.m_lazy_bodies.begin(), other.m_lazy_bodies.end());
+
+        return node_offset;
+    }
+
+    void ast::setChildren(node_id id, std::span<const node_id> children)
+    {
+        if (m_children.size() + children.size() > UINT32_MAX)
+            throw std::length_error("too many nodes in a module");
+
+        auto& node = m_nodes[id];
+        node.children_beg = static_cast<std::uint32_t>(m_children.size());
+        node.children_count = static_cast<std::uint32_t>(children.size());
+        m_children.insert(m_children.end(), children.begin(), children.end());
+    }
+
+    void ast::setRange(node_id id, source_position beg, source_position end)
+    {
+        m_nodes[id].beg = beg;
+        m_nodes[id].end = end;
+    }
+
+    void ast::shiftLines(node_id first, node_id last, unsigned from_line, int delta)
+    {
+        for (auto it = m_nodes.begin() + first; it != m_nodes.begin() + last; ++it)
+        {
+            if (it->beg.line >= from_line)
+                it->beg.line += delta;
+            if (it->end.line >= from_line)
+                it->end.line += delta;
+        }
+    }
+}
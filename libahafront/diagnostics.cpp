@@ -0,0 +1,50 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/diagnostics.hpp"
+
+namespace aha::front
+{
+    diagnostics::diagnostics() = default;
+    diagnostics::~diagnostics() = default;
+
+    void diagnostics::report(source& src, source_position pos, std::string_view message)
+    {
+        m_list.push_back({ &src, pos, message });
+    }
+
+    void diagnostics::clear()
+    {
+        m_list.clear();
+    }
+
+    bool diagnostics::empty() const
+    {
+        return m_list.empty();
+    }
+
+    const std::vector<diagnostic>& diagnostics::get() const
+    {
+        return m_list;
+    }
+}
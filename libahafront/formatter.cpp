@@ -0,0 +1,308 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/formatter.hpp"
+
+#include "aha/front/source.hpp"
+#include "aha/front/lexer.hpp"
+
+#include "utf8.h"
+
+namespace
+{
+    using namespace aha::front;
+
+    bool is_before(source_position lhs, source_position rhs)
+    {
+        return lhs.line < rhs.line || (lhs.line == rhs.line && lhs.col < rhs.col);
+    }
+
+    bool is_empty(source_range range)
+    {
+        return !is_before(range.beg, range.end);
+    }
+
+    void append_range(std::u8string& out, source& src, source_range range)
+    {
+        for (auto pos = range.beg; is_before(pos, range.end); pos = pos.next(src))
+            append_utf8(out, src.getChar(pos));
+    }
+
+    // trivia consists only of blanks and comments, and a comment starts with '#' or '/'
+    template <typename Func>
+    void for_each_comment(std::u8string_view trivia, Func func)
+    {
+        std::size_t idx = 0;
+
+        while ((idx = trivia.find_first_of(u8"#/", idx)) != std::u8string_view::npos)
+        {
+            std::size_t end;
+            if (trivia.compare(idx, 2, u8"/*") == 0)
+                end = trivia.find(u8"*/", idx + 2) + 2;
+            else
+                end = std::min(trivia.find(u8'\n', idx), trivia.size());
+
+            // without the trailing blanks of a line comment
+            auto comment = trivia.substr(idx, end - idx);
+            comment = comment.substr(0, comment.find_last_not_of(u8" \t") + 1);
+
+            func(comment);
+            idx = end;
+        }
+    }
+
+    class writer
+    {
+    public:
+        explicit writer(const format_options& opts)
+            : m_opts(opts)
+        {
+        }
+
+        void setIndent(unsigned level)
+        {
+            m_indent = level;
+        }
+
+        // a space, unless nothing is written on this line yet
+        void space()
+        {
+            if (!m_line_empty)
+                m_out += u8' ';
+        }
+
+        void put(std::u8string_view text)
+        {
+            if (m_line_empty)
+            {
+                m_out.append(m_indent * m_opts.indent_width, u8' ');
+                m_line_empty = false;
+            }
+
+            m_out += text;
+        }
+
+        // returns whether there was any comment
+        bool putComments(source& src, source_range trivia, bool space_after)
+        {
+            if (is_empty(trivia))
+                return false;
+
+            m_trivia.clear();
+            append_range(m_trivia, src, trivia);
+
+            bool any = false;
+            for_each_comment(m_trivia, [&](std::u8string_view comment) {
+                space();
+                put(comment);
+                if (space_after)
+                    m_out += u8' ';
+                any = true;
+            });
+
+            return any;
+        }
+
+        void newline()
+        {
+            if (m_line_empty)
+            {
+                // blank line; never at the start of the file
+                if (m_out.empty() || m_blank_lines >= m_opts.max_blank_lines)
+                    return;
+                ++m_blank_lines;
+            }
+            else
+            {
+                while (m_out.back() == u8' ')
+                    m_out.pop_back();
+                m_blank_lines = 0;
+            }
+
+            m_out += u8'\n';
+            m_line_empty = true;
+            m_indent = 0;
+        }
+
+        std::u8string finish()
+        {
+            if (!m_line_empty)
+                newline();
+
+            // no blank lines at the end of the file
+            while (m_out.size() >= 2 && m_out[m_out.size() - 1] == u8'\n' && m_out[m_out.size() - 2] == u8'\n')
+                m_out.pop_back();
+
+            return std::move(m_out);
+        }
+
+    private:
+        const format_options& m_opts;
+
+        std::u8string m_out;
+        std::u8string m_trivia;
+        bool m_line_empty = true;
+        unsigned m_indent = 0;
+        unsigned m_blank_lines = 0;
+    };
+
+    // what must survive formatting: tokens without blank lines, indentation by level, and comments
+    struct file_signature
+    {
+        std::vector<std::pair<std::size_t, std::u8string>> tokens;
+        std::vector<std::u8string> comments;
+
+        bool operator ==(const file_signature&) const = default;
+    };
+
+    file_signature make_signature(std::string_view content)
+    {
+        const auto indent_kind = decltype(token::data) { token_indent { } }.index();
+        const auto newline_kind = decltype(token::data) { token_newline { } }.index();
+
+        repl_source src;
+        lexer ll;
+        ll.enableTrivia(true);
+
+        src.feedString(content);
+        src.feedEof();
+
+        file_signature ret;
+        auto& tokens = ret.tokens;
+
+        std::u8string trivia;
+        source_position last_end { 0, 0 };
+
+        auto add_comments = [&](source_range range) {
+            trivia.clear();
+            append_range(trivia, src, range);
+            for_each_comment(trivia, [&](std::u8string_view comment) {
+                ret.comments.emplace_back(comment);
+            });
+        };
+
+        while (auto tok = ll.lex(src))
+        {
+            auto kind = tok->data.index();
+            std::u8string text;
+
+            last_end = tok->trailing_trivia.end;
+            add_comments(tok->leading_trivia);
+            add_comments(tok->trailing_trivia);
+
+            if (kind == newline_kind)
+            {
+                // drop blank lines, and lines with nothing but comments
+                if (!tokens.empty() && tokens.back().first == indent_kind)
+                    tokens.pop_back();
+                if (tokens.empty() || tokens.back().first == newline_kind)
+                    continue;
+            }
+            else if (kind == indent_kind)
+            {
+                text.append(std::get<token_indent>(tok->data).level, u8' ');
+            }
+            else
+            {
+                append_range(text, src, { tok->leading_trivia.end, tok->trailing_trivia.beg });
+            }
+
+            tokens.emplace_back(kind, std::move(text));
+        }
+
+        add_comments({ last_end, src.getEndpoint() });
+
+        // the same for the end of the file, which may lack the last newline
+        while (!tokens.empty() && (tokens.back().first == newline_kind || tokens.back().first == indent_kind))
+            tokens.pop_back();
+
+        return ret;
+    }
+}
+
+namespace aha::front
+{
+    std::string format_source(std::string_view content, std::string name, const format_options& opts)
+    {
+        std::u8string out;
+
+        try
+        {
+            repl_source src(name);
+            lexer ll;
+            ll.enableTrivia(true);
+
+            src.feedString(content);
+            src.feedEof();
+
+            writer w(opts);
+            std::u8string text;
+            source_position last_end { 0, 0 };
+
+            while (auto tok = ll.lex(src))
+            {
+                last_end = tok->trailing_trivia.end;
+
+                if (auto indent = std::get_if<token_indent>(&tok->data))
+                {
+                    w.setIndent(indent->level);
+                    w.putComments(src, tok->trailing_trivia, false);
+                }
+                else if (std::holds_alternative<token_newline>(tok->data))
+                {
+                    w.putComments(src, tok->leading_trivia, false);
+                    w.putComments(src, tok->trailing_trivia, false);
+                    w.newline();
+                }
+                else
+                {
+                    if (!is_empty(tok->leading_trivia) && !w.putComments(src, tok->leading_trivia, true))
+                        w.space();
+
+                    text.clear();
+                    append_range(text, src, { tok->leading_trivia.end, tok->trailing_trivia.beg });
+                    w.put(text);
+
+                    w.putComments(src, tok->trailing_trivia, false);
+                }
+            }
+
+            // comments after the last token, e.g. in a file with nothing else
+            w.putComments(src, { last_end, src.getEndpoint() }, false);
+
+            out = w.finish();
+
+            std::string_view result(reinterpret_cast<const char*>(out.data()), out.size());
+            if (make_signature(content) != make_signature(result))
+                throw format_error(name + ": formatting would change the tokens");
+        }
+        catch (source_positional_error& ex)
+        {
+            // the source dies here, so keep only the message
+            auto pos = ex.getPosition();
+            throw format_error(name + ":" + std::to_string(pos.line + 1) + ":" + std::to_string(pos.col + 1) + ": " + ex.what());
+        }
+
+        return std::string(reinterpret_cast<const char*>(out.data()), out.size());
+    }
+}
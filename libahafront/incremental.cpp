@@ -0,0 +1,631 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/incremental.hpp"
+
+namespace
+{
+    using namespace aha::front;
+
+    bool is_before(source_position lhs, source_position rhs)
+    {
+        return lhs.line < rhs.line || (lhs.line == rhs.line && lhs.col < rhs.col);
+    }
+
+    // lexes text, which starts at line 0; false if there is any lexer error
+    bool lex_text(lexer& ll, diagnostics& diag, source& src, std::vector<token>& tokens)
+    {
+        diag.clear();
+
+        try
+        {
+            while (auto tok = ll.lex(src))
+                tokens.push_back(std::move(*tok));
+        }
+        catch (source_positional_error& ex)
+        {
+            diag.report(src, ex.getPosition(), "invalid input");
+        }
+
+        return diag.empty();
+    }
+
+    // whether no line of text is a comment indented less than width
+    bool shallow_comments_free(std::string_view text, std::size_t width)
+    {
+        for (std::size_t pos = 0; pos < text.size(); )
+        {
+            auto end = std::min(text.find('\n', pos), text.size());
+            auto first = text.find_first_not_of(" \t", pos);
+
+            if (first < end && first - pos < width && (text[first] == '/' || text[first] == '#'))
+                return false;
+
+            pos = end + 1;
+        }
+
+        return true;
+    }
+
+    // an interpolated string left open would go on into the lines after
+    bool interpolations_closed(const std::vector<token>& tokens)
+    {
+        std::size_t depth = 0;
+        for (auto& tok : tokens)
+        {
+            if (std::holds_alternative<token_interpol_string_start>(tok.data))
+                ++depth;
+            else if (std::holds_alternative<token_interpol_string_end>(tok.data) && depth != 0)
+                --depth;
+        }
+
+        return depth == 0;
+    }
+
+    // whether an interpolated string is open at a line break
+    bool interpolation_spans_lines(std::span<const token> tokens)
+    {
+        std::size_t depth = 0;
+        for (auto& tok : tokens)
+        {
+            if (std::holds_alternative<token_interpol_string_start>(tok.data))
+                ++depth;
+            else if (std::holds_alternative<token_interpol_string_end>(tok.data) && depth != 0)
+                --depth;
+            else if (std::holds_alternative<token_newline>(tok.data) && depth != 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    // whether tokens, which start at line 'first', are old with the lines moved by delta
+    bool same_tokens(std::span<const token> tokens, unsigned first, std::span<const token> old, int delta)
+    {
+        auto same = [&](source_position pos, source_position old_pos) {
+            return static_cast<int>(pos.line + first) - delta == static_cast<int>(old_pos.line) && pos.col == old_pos.col;
+        };
+
+        return std::equal(tokens.begin(), tokens.end(), old.begin(), old.end(), [&](const token& lhs, const token& rhs) {
+            return lhs.data.index() == rhs.data.index() && same(lhs.beg, rhs.beg) && same(lhs.end, rhs.end);
+        });
+    }
+
+    void shift_token(token& tok, int delta)
+    {
+        tok.beg.line += delta;
+        tok.end.line += delta;
+    }
+
+    // replaces errors in lines [first, last] by errors of the reparsed lines, which start at line 0
+    void splice_errors(std::vector<diagnostic>& errors, unsigned first, unsigned last, int delta,
+        const std::vector<diagnostic>& added)
+    {
+        auto beg = std::find_if(errors.begin(), errors.end(), [&](auto& d) { return d.pos.line >= first; });
+        auto end = std::find_if(beg, errors.end(), [&](auto& d) { return d.pos.line > last; });
+
+        for (auto it = end; it != errors.end(); ++it)
+            it->pos.line += delta;
+
+        auto at = errors.erase(beg, end);
+        for (auto& d : added)
+        {
+            at = errors.insert(at, { nullptr, { d.pos.line + first, d.pos.col }, d.message });
+            ++at;
+        }
+    }
+}
+
+namespace aha::front
+{
+    incremental_parser::incremental_parser(std::string name)
+        : m_name(std::move(name)), m_lines { 0 }, m_full_size(0), m_interpolation_spans_lines(false), m_last { true, null_node, 0, 0, 0 }
+    {
+        m_lexer.setDiagnostics(&m_lexer_diag);
+        m_parser.setDiagnostics(&m_parser_diag);
+    }
+
+    incremental_parser::~incremental_parser() = default;
+
+    void incremental_parser::reset(std::string_view text)
+    {
+        m_text.clear();
+        m_lines.assign(1, 0);
+        replaceText(0, 0, text);
+
+        parseAll();
+    }
+
+    const std::string& incremental_parser::getText() const
+    {
+        return m_text;
+    }
+
+    const ast& incremental_parser::getModule() const
+    {
+        return m_tree;
+    }
+
+    std::span<const token> incremental_parser::getTokens() const
+    {
+        return m_tokens;
+    }
+
+    std::span<const node_id> incremental_parser::getTokenNodes() const
+    {
+        return m_token_nodes;
+    }
+
+    node_id incremental_parser::nodeAt(source_position pos) const
+    {
+        auto it = std::upper_bound(m_tokens.begin(), m_tokens.end(), pos,
+            [](source_position pos, const token& tok) { return is_before(pos, tok.beg); });
+
+        if (it == m_tokens.begin() || !is_before(pos, (it - 1)->end))
+            return null_node;
+        return m_token_nodes[it - 1 - m_tokens.begin()];
+    }
+
+    const std::vector<diagnostic>& incremental_parser::getLexerErrors() const
+    {
+        return m_lexer_errors;
+    }
+
+    const std::vector<diagnostic>& incremental_parser::getParserErrors() const
+    {
+        return m_parser_errors;
+    }
+
+    const incremental_parser::reparse_info& incremental_parser::getLastReparse() const
+    {
+        return m_last;
+    }
+
+    void incremental_parser::edit(source_position beg, source_position end, std::string_view text)
+    {
+        if (is_before(end, beg))
+            throw std::out_of_range("incremental_parser::edit: the end is before the beginning");
+
+        auto beg_offset = byteOffset(beg);
+        auto end_offset = byteOffset(end);
+
+        int delta = static_cast<int>(std::count(text.begin(), text.end(), '\n')) - static_cast<int>(end.line - beg.line);
+
+        // a block comment may reach out of the lines around the edit; see reparse()
+        auto around = std::string_view(m_text).substr(beg_offset ? beg_offset - 1 : 0, end_offset - beg_offset + 2);
+        bool removed_comment = around.find("/*") != std::string_view::npos;
+
+        // the containers around the edit, from the innermost; decided before the text changes
+        std::vector<region> regions;
+
+        if (m_tree.root() != null_node && m_tree.size() <= m_full_size * 2 + 1024)
+        {
+            m_path.assign(1, m_tree.root());
+
+            for (auto container = m_tree.root(); container != null_node; )
+            {
+                region reg { container, static_cast<unsigned>(regions.size()), m_path.size() };
+                if (!makeRegion(reg, beg, end.line))
+                    break;
+                regions.push_back(std::move(reg));
+
+                // go into the item if the edit is inside the lines of its own items
+                auto list = items(container);
+                auto& last = regions.back();
+                if (last.last - last.first != 1)
+                    break;
+
+                auto item = list[last.first];
+                auto nested = nestedContainer(item);
+                if (nested == null_node)
+                    break;
+
+                auto nested_items = items(nested);
+                if (nested_items.empty() || m_tree[nested_items.front()].beg.line > beg.line
+                    || m_tree[nested_items.back()].end.line < end.line)
+                {
+                    break;
+                }
+
+                if (nested != item)
+                    m_path.push_back(item);
+                m_path.push_back(nested);
+                container = nested;
+            }
+        }
+
+        replaceText(beg_offset, end_offset, text);
+
+        for (auto it = regions.rbegin(); it != regions.rend(); ++it)
+        {
+            if (reparse(*it, delta, removed_comment))
+                return;
+        }
+
+        parseAll();
+    }
+
+    void incremental_parser::parseAll()
+    {
+        m_tree = ast();
+        m_tokens.clear();
+        m_token_nodes.clear();
+        m_lexer_errors.clear();
+        m_parser_errors.clear();
+
+        repl_source src(m_name);
+        src.feedString(m_text);
+        src.feedEof();
+
+        m_lexer.clearAll();
+        m_lexer.setIndentation({ }, { });
+        lex_text(m_lexer, m_lexer_diag, src, m_tokens);
+
+        m_token_nodes.resize(m_tokens.size());
+        m_interpolation_spans_lines = interpolation_spans_lines(m_tokens);
+        m_parser_diag.clear();
+
+        std::vector<node_id> decls;
+        m_parser.parseItems(m_tree, m_tokens, node_kind::module, 0, decls, m_token_nodes);
+
+        source_position beg { 0, 0 }, end { 0, 0 };
+        if (!decls.empty())
+        {
+            beg = m_tree[decls.front()].beg;
+            end = m_tree[decls.back()].end;
+        }
+
+        auto root = m_tree.add(node_kind::module, beg, end, decls);
+        m_tree.setRoot(root);
+
+        std::replace(m_token_nodes.begin(), m_token_nodes.end(), null_node, root);
+        for (auto& tok : m_tokens)
+            tok.ptr_src = nullptr;
+
+        for (auto& d : m_lexer_diag.get())
+            m_lexer_errors.push_back({ nullptr, d.pos, d.message });
+        for (auto& d : m_parser_diag.get())
+            m_parser_errors.push_back({ nullptr, d.pos, d.message });
+
+        m_full_size = m_tree.size();
+        m_last = { true, root, 0, static_cast<unsigned>(m_lines.size()), m_tokens.size() };
+    }
+
+    // the lines of the region are lexed and parsed alone, as the items of the container.
+    // it fails if they are not such items, and then an outer container is tried.
+    bool incremental_parser::reparse(const region& reg, int delta, bool removed_comment)
+    {
+        auto kind = m_tree[reg.container].kind;
+        bool top_level = (kind == node_kind::module);
+
+        int last_line = static_cast<int>(reg.last_line) + delta;
+        auto text = lineText(reg.first_line, last_line);
+
+        // a block comment that begins in the lines may end outside of them.
+        // at the top level, the lines reach the next declaration, so the comment ends inside.
+        if (!top_level && (removed_comment || text.find("/*") != std::string_view::npos))
+            return false;
+
+        // a comment line less indented than the items changes the levels of the lines after it
+        if (!top_level && !shallow_comments_free(text, reg.widths.back()))
+            return false;
+
+        // the lines may begin, or the old ones end, in the middle of an interpolated string
+        if (m_interpolation_spans_lines)
+            return false;
+
+        auto token_beg = tokenIndex({ reg.first_line, 0 });
+        auto token_end = tokenIndex({ reg.last_line + 1, 0 });
+
+        // the line after the lines is lexed as well, and must give its old tokens;
+        // otherwise the lexer goes on in another state than before
+        bool has_next = static_cast<std::size_t>(last_line) + 1 < m_lines.size();
+
+        repl_source src(m_name);
+        src.feedString(has_next ? lineText(reg.first_line, last_line + 1) : text);
+        src.feedEof();
+
+        m_lexer.clearAll();
+        m_lexer.setIndentation(reg.indent, reg.widths);
+
+        std::vector<token> tokens;
+        if (!lex_text(m_lexer, m_lexer_diag, src, tokens))
+            return false;
+
+        if (has_next)
+        {
+            auto next_line = static_cast<unsigned>(last_line - static_cast<int>(reg.first_line) + 1);
+            auto next = std::find_if(tokens.begin(), tokens.end(), [&](auto& tok) { return tok.beg.line >= next_line; });
+
+            auto old_next = std::span(m_tokens).subspan(token_end, tokenIndex({ reg.last_line + 2, 0 }) - token_end);
+            if (!same_tokens({ next, tokens.end() }, reg.first_line, old_next, delta))
+                return false;
+
+            tokens.erase(next, tokens.end());
+        }
+
+        if (!interpolations_closed(tokens))
+            return false;
+
+        m_interpolation_spans_lines = interpolation_spans_lines(tokens);
+
+        std::vector<node_id> new_items;
+        std::vector<node_id> token_nodes(tokens.size());
+        auto first_new = static_cast<node_id>(m_tree.size());
+
+        m_parser_diag.clear();
+        if (!m_parser.parseItems(m_tree, tokens, kind, reg.level, new_items, token_nodes))
+            return false;
+
+        // ends of the ancestors that lay in the old lines are recomputed below
+        std::vector<bool> end_in_region(reg.path_size);
+        for (std::size_t i = 0; i < reg.path_size; ++i)
+        {
+            auto line = m_tree[m_path[i]].end.line;
+            end_in_region[i] = (reg.first_line <= line && line <= reg.last_line);
+        }
+
+        m_tree.shiftLines(0, first_new, reg.last_line + 1, delta);
+        m_tree.shiftLines(first_new, static_cast<node_id>(m_tree.size()), 0, static_cast<int>(reg.first_line));
+
+        // the items of the container, with the type parameters of a class
+        auto old_children = m_tree.children(reg.container);
+        auto list = items(reg.container);
+        auto skip = old_children.size() - list.size();
+
+        std::vector<node_id> children(old_children.begin(), old_children.begin() + skip + reg.first);
+        children.insert(children.end(), new_items.begin(), new_items.end());
+        children.insert(children.end(), old_children.begin() + skip + reg.last, old_children.end());
+        m_tree.setChildren(reg.container, children);
+
+        for (auto i = reg.path_size; i-- > 0; )
+        {
+            auto id = m_path[i];
+            auto node = m_tree[id];
+            auto node_children = m_tree.children(id);
+
+            if (node_children.empty())
+            {
+                m_tree.setRange(id, { 0, 0 }, { 0, 0 });
+                continue;
+            }
+
+            if (node.kind == node_kind::module || node.kind == node_kind::block)
+                node.beg = m_tree[node_children.front()].beg;
+            if (end_in_region[i])
+                node.end = m_tree[node_children.back()].end;
+
+            m_tree.setRange(id, node.beg, node.end);
+        }
+
+        // tokens of the old lines are replaced, and the rest moves by delta lines
+        for (auto it = m_tokens.begin() + token_end; it != m_tokens.end(); ++it)
+            shift_token(*it, delta);
+
+        for (auto& tok : tokens)
+        {
+            shift_token(tok, static_cast<int>(reg.first_line));
+            tok.ptr_src = nullptr;
+        }
+        std::replace(token_nodes.begin(), token_nodes.end(), null_node, reg.container);
+
+        m_tokens.erase(m_tokens.begin() + token_beg, m_tokens.begin() + token_end);
+        m_tokens.insert(m_tokens.begin() + token_beg, std::make_move_iterator(tokens.begin()), std::make_move_iterator(tokens.end()));
+        m_token_nodes.erase(m_token_nodes.begin() + token_beg, m_token_nodes.begin() + token_end);
+        m_token_nodes.insert(m_token_nodes.begin() + token_beg, token_nodes.begin(), token_nodes.end());
+
+        splice_errors(m_lexer_errors, reg.first_line, reg.last_line, delta, m_lexer_diag.get());
+        splice_errors(m_parser_errors, reg.first_line, reg.last_line, delta, m_parser_diag.get());
+
+        m_last = { false, reg.container, reg.first_line, static_cast<unsigned>(last_line - static_cast<int>(reg.first_line) + 1), tokens.size() };
+        return true;
+    }
+
+    // the items are the lines that a container is made of
+    std::span<const node_id> incremental_parser::items(node_id container) const
+    {
+        auto children = m_tree.children(container);
+
+        if (m_tree[container].kind == node_kind::class_decl || m_tree[container].kind == node_kind::interface_decl)
+        {
+            while (!children.empty() && m_tree[children.front()].kind == node_kind::type_param)
+                children = children.subspan(1);
+        }
+
+        return children;
+    }
+
+    // the container of the lines under an item, if any
+    node_id incremental_parser::nestedContainer(node_id item) const
+    {
+        auto& node = m_tree[item];
+
+        switch (node.kind)
+        {
+        case node_kind::class_decl:
+        case node_kind::interface_decl:
+            return item;
+
+        case node_kind::func_decl:
+        case node_kind::block_stmt:
+        {
+            auto children = m_tree.children(item);
+            if (!children.empty() && m_tree[children.back()].kind == node_kind::block)
+                return children.back();
+            return null_node;
+        }
+
+        default:
+            return null_node;
+        }
+    }
+
+    // the first token at or after pos
+    std::size_t incremental_parser::tokenIndex(source_position pos) const
+    {
+        auto it = std::lower_bound(m_tokens.begin(), m_tokens.end(), pos,
+            [](const token& tok, source_position pos) { return is_before(tok.beg, pos); });
+        return it - m_tokens.begin();
+    }
+
+    // whether the item begins right after the indentation of its line, without a comment between
+    bool incremental_parser::startsLine(node_id item, unsigned level) const
+    {
+        auto beg = m_tree[item].beg;
+        auto idx = tokenIndex(beg);
+
+        if (idx == m_tokens.size() || is_before(beg, m_tokens[idx].beg))
+            return false;
+
+        // a line without indentation is lexed the same whatever the lines before are
+        if (level == 0)
+            return beg.col == 0 && !std::holds_alternative<token_indent>(m_tokens[idx].data)
+                && !std::holds_alternative<token_error>(m_tokens[idx].data);
+
+        auto& prev = m_tokens[idx - 1];
+        auto indent = std::get_if<token_indent>(&prev.data);
+        return indent && indent->level == level && prev.end.line == beg.line && prev.end.col == beg.col;
+    }
+
+    // the items whose lines contain the edit, and the indentation to lex them from
+    bool incremental_parser::makeRegion(region& reg, source_position edit_beg, unsigned edit_last) const
+    {
+        auto list = items(reg.container);
+        bool top_level = (m_tree[reg.container].kind == node_kind::module);
+
+        auto line_of = [&](std::size_t idx) { return m_tree[list[idx]].beg.line; };
+
+        // items from the last one beginning at or before the edit, to the last one beginning in it
+        std::size_t first = 0;
+        while (first + 1 < list.size() && line_of(first + 1) <= edit_beg.line)
+            ++first;
+
+        std::size_t last = first;
+        while (last < list.size() && line_of(last) <= edit_last)
+            ++last;
+        last = std::max(last, std::min(first + 1, list.size()));
+
+        // lines put before an item, or more indented than before, may belong to the previous one
+        auto first_beg = (list.empty() ? source_position { 0, 0 } : m_tree[list[first]].beg);
+        if (first > 0 && first_beg.line == edit_beg.line && !is_before(first_beg, edit_beg))
+            --first;
+
+        // an item after a comment in its line goes together with the previous one
+        while (first > 0 && !startsLine(list[first], reg.level))
+            --first;
+        while (last < list.size() && !startsLine(list[last], reg.level))
+            ++last;
+
+        reg.first = first;
+        reg.last = last;
+
+        if (top_level)
+        {
+            bool clean = !list.empty() && startsLine(list[first], 0) && line_of(first) <= edit_beg.line;
+            reg.first_line = (clean ? line_of(first) : 0);
+            reg.last_line = (last < list.size() ? line_of(last) - 1 : static_cast<unsigned>(m_lines.size() - 1));
+            return true;
+        }
+
+        if (list.empty() || !startsLine(list[first], reg.level))
+            return false;
+
+        reg.first_line = line_of(first);
+        reg.last_line = (last < list.size() ? line_of(last) - 1 : m_tree[list.back()].end.line);
+
+        // the indentation of the first line, and of each level up to it
+        auto idx = tokenIndex(m_tree[list[first]].beg) - 1;
+        auto width = m_tokens[idx].end.col;
+
+        reg.widths.assign(reg.level, 0);
+        reg.widths[reg.level - 1] = width;
+
+        auto line = std::string_view(m_text).substr(m_lines[reg.first_line], width);
+        reg.indent.assign(line.begin(), line.end());
+
+        // the last line at each lower level before it
+        for (auto level = reg.level - 1; level > 0; )
+        {
+            if (idx-- == 0)
+                return false;
+
+            auto indent = std::get_if<token_indent>(&m_tokens[idx].data);
+            if (indent && indent->level == level)
+                reg.widths[--level] = m_tokens[idx].end.col;
+        }
+
+        return true;
+    }
+
+    std::size_t incremental_parser::byteOffset(source_position pos) const
+    {
+        if (pos.line >= m_lines.size())
+            throw std::out_of_range("incremental_parser: the line is out of the text");
+
+        auto offset = m_lines[pos.line];
+        auto line_end = (pos.line + 1 < m_lines.size() ? m_lines[pos.line + 1] - 1 : m_text.size());
+
+        // skips pos.col code points
+        for (unsigned col = 0; col < pos.col; ++col)
+        {
+            if (offset >= line_end)
+                throw std::out_of_range("incremental_parser: the column is out of the line");
+
+            do
+                ++offset;
+            while (offset < line_end && (static_cast<unsigned char>(m_text[offset]) & 0xc0) == 0x80);
+        }
+
+        return offset;
+    }
+
+    void incremental_parser::replaceText(std::size_t beg, std::size_t end, std::string_view text)
+    {
+        auto first = std::upper_bound(m_lines.begin(), m_lines.end(), beg);
+        auto last = std::upper_bound(first, m_lines.end(), end);
+
+        std::vector<std::size_t> added;
+        for (auto pos = text.find('\n'); pos != std::string_view::npos; pos = text.find('\n', pos + 1))
+            added.push_back(beg + pos + 1);
+
+        auto diff = static_cast<std::ptrdiff_t>(text.size()) - static_cast<std::ptrdiff_t>(end - beg);
+        for (auto it = last; it != m_lines.end(); ++it)
+            *it += diff;
+
+        auto at = m_lines.erase(first, last);
+        m_lines.insert(at, added.begin(), added.end());
+
+        m_text.replace(beg, end - beg, text);
+    }
+
+    // lines [first, last] with their newlines; empty if last is before first
+    std::string_view incremental_parser::lineText(unsigned first, int last) const
+    {
+        if (last < static_cast<int>(first))
+            return { };
+
+        auto beg = m_lines[first];
+        auto end = (static_cast<std::size_t>(last) + 1 < m_lines.size() ? m_lines[last + 1] : m_text.size());
+        return std::string_view(m_text).substr(beg, end - beg);
+    }
+}
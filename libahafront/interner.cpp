@@ -0,0 +1,235 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/interner.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <bit>
+#include <cstring>
+
+namespace
+{
+    using namespace aha::front;
+
+    // a symbol is the index of its text in the shard, then the shard
+    constexpr unsigned shard_bits = 6;
+    constexpr std::size_t shard_count = std::size_t(1) << shard_bits;
+    constexpr std::uint32_t max_entries = (UINT32_MAX >> shard_bits);
+
+    // entries are kept in segments which never move; segment k holds first_segment << k entries
+    constexpr unsigned first_segment_bits = 8;
+    constexpr std::size_t first_segment = std::size_t(1) << first_segment_bits;
+    constexpr unsigned segment_count = 32 - shard_bits - first_segment_bits + 1;
+
+    constexpr std::size_t first_table = 64;
+    constexpr std::size_t chunk_size = 64 * 1024;
+
+    struct entry
+    {
+        const char8_t* data;
+        std::uint32_t length;
+        std::uint32_t hash;
+    };
+
+    // open addressing; a slot holds the index of an entry + 1, or 0 if empty
+    struct table
+    {
+        std::size_t mask;
+        std::unique_ptr<std::atomic<std::uint32_t>[]> slots;
+
+        explicit table(std::size_t size)
+            : mask(size - 1), slots(std::make_unique<std::atomic<std::uint32_t>[]>(size))
+        {
+        }
+    };
+
+    std::pair<unsigned, std::size_t> segment_of(std::uint32_t idx)
+    {
+        auto k = static_cast<unsigned>(std::bit_width((idx >> first_segment_bits) + 1) - 1);
+        return { k, idx - first_segment * ((std::size_t(1) << k) - 1) };
+    }
+}
+
+namespace aha::front
+{
+    struct string_interner::shard
+    {
+        std::atomic<table*> current { nullptr };
+        std::atomic<entry*> segments[segment_count] { };
+        std::atomic<std::uint32_t> count { 0 };
+
+        // the rest is used only under the mutex. replaced tables are kept, since a reader may still
+        // be probing them; it then misses a new text and looks again under the mutex.
+        std::mutex mutex;
+        std::vector<std::unique_ptr<table>> tables;
+        std::vector<std::unique_ptr<entry[]>> segment_data;
+        std::vector<std::unique_ptr<char8_t[]>> chunks;
+        char8_t* chunk_pos = nullptr;
+        std::size_t chunk_left = 0;
+
+        const entry& at(std::uint32_t idx) const
+        {
+            auto [k, offset] = segment_of(idx);
+            return segments[k].load(std::memory_order_acquire)[offset];
+        }
+
+        // the index of the entry, or max_entries
+        std::uint32_t find(const table& t, std::u8string_view text, std::uint32_t hash) const
+        {
+            for (auto pos = hash & t.mask; ; pos = (pos + 1) & t.mask)
+            {
+                auto slot = t.slots[pos].load(std::memory_order_acquire);
+                if (slot == 0)
+                    return max_entries;
+
+                auto& e = at(slot - 1);
+                if (e.hash == hash && std::u8string_view(e.data, e.length) == text)
+                    return slot - 1;
+            }
+        }
+
+        void insert(table& t, std::uint32_t idx, std::uint32_t hash)
+        {
+            auto pos = hash & t.mask;
+            while (t.slots[pos].load(std::memory_order_relaxed) != 0)
+                pos = (pos + 1) & t.mask;
+            t.slots[pos].store(idx + 1, std::memory_order_release);
+        }
+
+        const char8_t* store(std::u8string_view text)
+        {
+            if (text.size() > chunk_size / 4)
+            {
+                chunks.push_back(std::make_unique<char8_t[]>(text.size()));
+                std::memcpy(chunks.back().get(), text.data(), text.size());
+                return chunks.back().get();
+            }
+
+            if (text.size() > chunk_left)
+            {
+                chunks.push_back(std::make_unique<char8_t[]>(chunk_size));
+                chunk_pos = chunks.back().get();
+                chunk_left = chunk_size;
+            }
+
+            auto ret = chunk_pos;
+            std::memcpy(chunk_pos, text.data(), text.size());
+            chunk_pos += text.size();
+            chunk_left -= text.size();
+            return ret;
+        }
+
+        std::uint32_t add(std::u8string_view text, std::uint32_t hash)
+        {
+            auto idx = count.load(std::memory_order_relaxed);
+            if (idx >= max_entries)
+                throw std::length_error("too many symbols");
+            if (text.size() > UINT32_MAX)
+                throw std::length_error("too long text to intern");
+
+            auto [k, offset] = segment_of(idx);
+            if (offset == 0)
+            {
+                segment_data.push_back(std::make_unique<entry[]>(first_segment << k));
+                segments[k].store(segment_data.back().get(), std::memory_order_release);
+            }
+
+            segment_data.back()[offset] = { text.empty() ? nullptr : store(text), static_cast<std::uint32_t>(text.size()), hash };
+
+            // at most half full
+            auto t = current.load(std::memory_order_relaxed);
+            if ((idx + 1) * 2 > t->mask + 1)
+            {
+                auto grown = std::make_unique<table>((t->mask + 1) * 2);
+                for (std::uint32_t i = 0; i < idx; ++i)
+                    insert(*grown, i, at(i).hash);
+
+                t = grown.get();
+                tables.push_back(std::move(grown));
+                current.store(t, std::memory_order_release);
+            }
+
+            insert(*t, idx, hash);
+            count.store(idx + 1, std::memory_order_release);
+            return idx;
+        }
+    };
+
+    string_interner::string_interner()
+        : m_shards(std::make_unique<shard[]>(shard_count))
+    {
+        for (std::size_t i = 0; i < shard_count; ++i)
+        {
+            auto& s = m_shards[i];
+            s.tables.push_back(std::make_unique<table>(first_table));
+            s.current.store(s.tables.back().get(), std::memory_order_relaxed);
+        }
+    }
+
+    string_interner::~string_interner() = default;
+
+    string_interner& string_interner::global()
+    {
+        static string_interner instance;
+        return instance;
+    }
+
+    symbol_id string_interner::intern(std::u8string_view text)
+    {
+        auto h = std::hash<std::u8string_view> { }(text);
+        auto& s = m_shards[h & (shard_count - 1)];
+        auto hash = static_cast<std::uint32_t>(h >> shard_bits);
+
+        auto idx = s.find(*s.current.load(std::memory_order_acquire), text, hash);
+        if (idx == max_entries)
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+
+            // added by another thread in the meantime, or not yet in the table read above
+            idx = s.find(*s.current.load(std::memory_order_relaxed), text, hash);
+            if (idx == max_entries)
+                idx = s.add(text, hash);
+        }
+
+        return (idx << shard_bits) | static_cast<symbol_id>(h & (shard_count - 1));
+    }
+
+    std::u8string_view string_interner::text(symbol_id sym) const
+    {
+        assert(sym != null_symbol);
+
+        auto& e = m_shards[sym & (shard_count - 1)].at(sym >> shard_bits);
+        return { e.data, e.length };
+    }
+
+    std::size_t string_interner::size() const
+    {
+        std::size_t ret = 0;
+        for (std::size_t i = 0; i < shard_count; ++i)
+            ret += m_shards[i].count.load(std::memory_order_relaxed);
+        return ret;
+    }
+}
@@ -25,28 +25,107 @@
 
 #include "aha/front/source.hpp"
 
-#include <boost/iterator/transform_iterator.hpp>
-
 #include "is_newline.h"
+#include "numconv.h"
+#include "scan.h"
+#include "stats.h"
+#include "utf8.h"
 #include "ext.h"
 
+#include <chrono>
+
 namespace
 {
     using namespace aha::front;
 
+    // immutable tables, shared by every lexer
+    constexpr std::u8string_view punct_chars = u8"~!@$%^&*()-=+[];:,./<>?|";
+
+    constexpr auto toks_punct = ext::make_array<std::u8string_view>(
+        u8"~", u8"!", u8"@", u8"$", u8"%", u8"^", u8"&", u8"*", u8"(", u8")", u8"-", u8"=", u8"+",
+        u8"[", u8"]", u8";", u8":", u8",", u8".", u8"/", u8"<", u8">", u8"?",
+        u8"++", u8"--", u8">>", u8"<<", u8"==", u8"!=", u8"<=", u8">=", u8"&&", u8"||",
+        u8"+=", u8"-=", u8"*=", u8"/=", u8"%=", u8"&=", u8"|=", u8"^=", u8"<<=", u8">>=", u8":=:",
+        u8"::", u8"->", u8"=>", u8"|>", u8"&>", u8"<&", u8"?.");
+
+    constexpr auto toks_punct_sorted = [] {
+        auto ar = toks_punct;
+        std::sort(ar.begin(), ar.end());
+        return ar;
+    }();
+
+    constexpr auto toks_keyword = ext::make_array<std::u8string_view>(
+        u8"module", u8"import", u8"class", u8"interface", u8"enum", u8"static", u8"final",
+        u8"public", u8"private", u8"protected", u8"internal",
+        u8"func", u8"in", u8"let", u8"var", u8"this", u8"event", u8"curry", u8"uncurry",
+        u8"byte", u8"sbyte", u8"short", u8"ushort", u8"int", u8"uint", u8"long", u8"ulong",
+        u8"bool", u8"object", u8"string");
+
+    constexpr auto toks_comment_line = ext::make_array<std::u8string_view>(
+        u8"#", u8"//");
+
+    constexpr std::u8string_view tok_comment_block_begin = u8"/*";
+    constexpr std::u8string_view tok_comment_block_end = u8"*/";
+
     template <typename TokenData>
     token make_token(TokenData&& data, source& src, source_position beg, source_position end)
     {
         token tok { &src, beg, end, std::forward<TokenData>(data) };
         return tok;
     }
+
+    bool contains(std::u8string_view chars, char32_t ch)
+    {
+        return ch < 0x80 && chars.find(static_cast<char8_t>(ch)) != std::u8string_view::npos;
+    }
+
+    bool parse_number_postfix(std::u8string_view str, number_postfix& postfix)
+    {
+        auto lower = [](char8_t ch) {
+            return (u8'A' <= ch && ch <= u8'Z') ? static_cast<char8_t>(ch - u8'A' + u8'a') : ch;
+        };
+
+        if (str.empty())
+        {
+            postfix = number_postfix::none;
+        }
+        else if (str.size() == 1)
+        {
+            switch (lower(str[0]))
+            {
+                case u8'u': postfix = number_postfix::u; break;
+                case u8'l': postfix = number_postfix::l; break;
+                case u8'f': postfix = number_postfix::f; break;
+                case u8'd': postfix = number_postfix::d; break;
+                default: return false;
+            }
+        }
+        else if (str.size() == 2)
+        {
+            auto ch0 = lower(str[0]), ch1 = lower(str[1]);
+            if ((ch0 == u8'u' && ch1 == u8'l') || (ch0 == u8'l' && ch1 == u8'u'))
+                postfix = number_postfix::ul;
+            else
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
 }
 
 namespace aha::front
 {
-    lexer::lexer()
+    lexer::lexer(std::pmr::memory_resource* resource)
+        : m_resource(resource), m_token_resource(resource), m_interner(&string_interner::global())
+        , m_buf(resource), m_str_token(resource), m_str_payload(resource), m_indent_str(resource), m_indent_pos(resource)
+        , m_diagnostics(nullptr), m_stats(nullptr)
     {
-        init();
+        m_flags.trivia = false;
+        clearAll();
     }
 
     lexer::~lexer() = default;
@@ -57,12 +136,15 @@ namespace aha::front
         m_flags.enable_interpol_block_end = false;
 
         m_last_result = lex_result::exhausted;
+
+        m_text_end = { 0, 0 };
     }
 
     void lexer::clearBuffer()
     {
         m_buf.clear();
         m_str_token.clear();
+        m_trivia_pending.reset();
 
         m_state = state::indent;
     }
@@ -75,30 +157,84 @@ namespace aha::front
 
     std::optional<token> lexer::lex(source& src)
     {
-        if (m_state == state::error)
-            throw std::logic_error("lexer has an error");
+#if AHA_FRONT_STATS
+        if (m_stats)
+        {
+            std::optional<token> tok;
+            if (m_stats->lex_calls++ % sample_interval == 0)
+            {
+                auto beg = sample_start();
+                tok = lexNext(src);
+                m_stats->lex_time += time_since(beg);
+                ++m_stats->timed_lex_calls;
+            }
+            else
+            {
+                tok = lexNext(src);
+            }
+
+            if (tok)
+            {
+                ++m_stats->tokens[tok->data.index()];
+
+                if (auto indent = std::get_if<token_indent>(&tok->data))
+                {
+                    auto& levels = m_stats->indent_levels;
+                    if (levels.size() <= indent->level)
+                        levels.resize(indent->level + 1);
+                    ++levels[indent->level];
+                }
+            }
+
+            return tok;
+        }
+#endif
+        return lexNext(src);
+    }
 
-        static const std::u32string_view punct_chars = U"~!@$%^&*()-=+[];:,./<>?|";
+    std::optional<token> lexer::lexNext(source& src)
+    {
+        if (!m_flags.trivia)
+            return lexToken(src);
 
-        static const auto toks_punct = ext::make_array<std::u32string_view>(
-            U"~", U"!", U"@", U"$", U"%", U"^", U"&", U"*", U"(", U")", U"-", U"=", U"+",
-            U"[", U"]", U";", U":", U",", U".", U"/", U"<", U">", U"?",
-            U"++", U"--", U">>", U"<<", U"==", U"!=", U"<=", U">=", U"&&", U"||",
-            U"+=", U"-=", U"*=", U"/=", U"%=", U"&=", U"|=", U"^=", U"<<=", U">>=", U":=:",
-            U"::", U"->", U"=>", U"|>", U"&>", U"<&", U"?.");
+        while (true)
+        {
+            auto tok = lexToken(src);
 
-        static const auto toks_keyword = ext::make_array<std::u32string_view>(
-            U"module", U"import", U"class", U"interface", U"enum", U"static", U"final",
-            U"public", U"private", U"protected", U"internal",
-            U"func", U"in", U"let", U"var", U"this", U"event", U"curry", U"uncurry",
-            U"byte", U"sbyte", U"short", U"ushort", U"int", U"uint", U"long", U"ulong",
-            U"bool", U"object", U"string");
+            if (!tok)
+            {
+                if (m_last_result == lex_result::eof && m_trivia_pending)
+                {
+                    // e.g. a line comment without newline at the end.
+                    // on a line of its own, it belongs to no token.
+                    if (!std::holds_alternative<token_newline>(m_trivia_pending->data))
+                        m_trivia_pending->trailing_trivia.end = src.getEndpoint();
+                    m_last_result = lex_result::done;
+                    return std::exchange(m_trivia_pending, std::nullopt);
+                }
+
+                return tok;
+            }
+
+            // a comment on its own line stays with the newline of that line
+            if (m_trivia_pending && std::holds_alternative<token_newline>(tok->data)
+                && !std::holds_alternative<token_newline>(m_trivia_pending->data))
+            {
+                m_trivia_pending->trailing_trivia.end = tok->leading_trivia.end;
+                tok->leading_trivia.beg = tok->leading_trivia.end;
+            }
 
-        static const auto toks_comment_line = ext::make_array<std::u32string_view>(
-            U"#", U"//");
+            if (!m_trivia_pending)
+                m_trivia_pending = std::move(tok);
+            else
+                return std::exchange(m_trivia_pending, std::move(tok));
+        }
+    }
 
-        static const std::u32string_view tok_comment_block_begin = U"/*";
-        static const std::u32string_view tok_comment_block_end = U"*/";
+    std::optional<token> lexer::lexToken(source& src)
+    {
+        if (m_state == state::error)
+            throw std::logic_error("lexer has an error");
 
         std::optional<token> ret;
 
@@ -109,19 +245,44 @@ namespace aha::front
 
             bool done = false;
             bool skip = false;
+            bool eof = false;
 
             auto revert = [this, &ch, &pos, &skip]() {
                 if (!skip)
-                    m_str_token.push_back(ch);
+                    append_utf8(m_str_token, ch);
 
-                m_buf_beg = m_tok_beg;
-                m_buf.insert(m_buf.begin(), m_str_token.begin(), m_str_token.end());
-                m_str_token.clear();
+                rebuffer();
             };
-            auto throwErrorWithRevert = [this, revert](auto&& ex) {
+            // throws, or reports the error and leaves the rest to state::recover.
+            // in the latter case, the caller must 'goto recover' right after this.
+            auto error = [this, revert, &src](source_position at, const char* msg) {
                 revert();
-                throwError(std::forward<decltype(ex)>(ex));
+
+                AHA_FRONT_COUNT(m_stats, errors++);
+
+                if (!m_diagnostics)
+                    throwError(lexer_error(src, at, msg));
+
+                m_diagnostics->report(src, at, msg);
+                m_error_beg = m_tok_beg;
+                m_error_msg = msg;
+                m_state = state::recover;
             };
+            // content of a string literal is not kept in m_str_token, so replaying it would lose ch.
+            // the recovery starts at ch instead, so a newline which ends the literal ends the error as well.
+            auto string_error = [this, error, &pos, &skip](source_position at, const char* msg) {
+                auto beg = m_tok_beg;
+
+                m_str_token.clear();
+                m_tok_beg = pos;
+                skip = false;
+
+                error(at, msg);
+                m_error_beg = beg;
+            };
+
+            if (m_buf.empty())
+                scanRun(src);
 
             if (!m_buf.empty())
             {
@@ -144,9 +305,10 @@ namespace aha::front
                 {
                     if (src.getState() == source_state::eof)
                     {
-                        if (!m_str_token.empty())
+                        if (!m_str_token.empty() || m_state == state::recover)
                         {
                             skip = true;
+                            eof = true;
                             ch = U'\0';
                             pos = src.getEndpoint().prev(src);
                         }
@@ -167,6 +329,9 @@ namespace aha::front
             if (m_str_token.empty())
                 m_tok_beg = pos;
 
+            AHA_FRONT_COUNT(m_stats, peak_token_buffer = std::max(m_stats->peak_token_buffer,
+                std::max(m_str_token.size(), m_str_payload.size())));
+
             if (m_state == state::indent)
             {
                 if (ch == U'\n' || src.getState() == source_state::eof)
@@ -195,7 +360,10 @@ namespace aha::front
                         if (m_str_token.size() == m_indent_str.size())
                         {
                             if (m_str_token != m_indent_str)
-                                throwErrorWithRevert(lexer_error(src, m_tok_beg, "invalid indentation"));
+                            {
+                                error(m_tok_beg, "invalid indentation");
+                                goto recover;
+                            }
                         }
                         else if (m_str_token.size() < m_indent_str.size())
                         {
@@ -203,18 +371,27 @@ namespace aha::front
                             while (1)
                             {
                                 if (m_str_token.size() > *it)
-                                    throwErrorWithRevert(lexer_error(src, m_tok_beg, "invalid indentation"));
+                                {
+                                    error(m_tok_beg, "invalid indentation");
+                                    goto recover;
+                                }
 
                                 if (m_str_token.size() == *it)
                                 {
                                     if (m_indent_str.compare(0, *it, m_str_token) != 0)
-                                        throwErrorWithRevert(lexer_error(src, m_tok_beg, "invalid indentation"));
+                                    {
+                                        error(m_tok_beg, "invalid indentation");
+                                        goto recover;
+                                    }
 
                                     break;
                                 }
 
                                 if (it == m_indent_pos.begin())
-                                    throwErrorWithRevert(lexer_error(src, m_tok_beg, "invalid indentation"));
+                                {
+                                    error(m_tok_beg, "invalid indentation");
+                                    goto recover;
+                                }
 
                                 --it;
                             }
@@ -225,7 +402,10 @@ namespace aha::front
                         else
                         {
                             if (m_str_token.compare(0, m_indent_str.size(), m_indent_str) != 0)
-                                throwErrorWithRevert(lexer_error(src, m_tok_beg, "invalid indentation"));
+                            {
+                                error(m_tok_beg, "invalid indentation");
+                                goto recover;
+                            }
 
                             m_indent_pos.push_back(m_str_token.size());
                             m_indent_str = std::move(m_str_token);
@@ -286,6 +466,12 @@ namespace aha::front
                         m_flags.comment_block = false;
                         m_flags.comment_block_contains_newline = false;
                         m_flags.comment_block_might_closing = false;
+                        m_flags.commented_out = false;
+                        m_flags.string_escape = false;
+                        m_flags.interpol_dollar = false;
+
+                        m_str_payload.clear();
+                        m_raw_delim_run = 0;
 
                         if (isIdentifierFirstChar(ch))
                         {
@@ -299,7 +485,7 @@ namespace aha::front
                         {
                             m_flags.decimal = true;
                         }
-                        else if (punct_chars.find(ch) != std::u32string_view::npos)
+                        else if (contains(punct_chars, ch))
                         {
                             if (ch == U'/')
                             {
@@ -316,6 +502,7 @@ namespace aha::front
                         else if (ch == U'#')
                         {
                             m_flags.comment_line = true;
+                            m_flags.commented_out = true;
                         }
                         else if (ch == U'\'' || ch == U'\"')
                         {
@@ -331,35 +518,32 @@ namespace aha::front
                         }
                         else
                         {
-                            throwErrorWithRevert(lexer_error(src, pos, "unexpected character"));
+                            error(pos, "unexpected character");
+                            goto recover;
                         }
                     }
                 }
                 else
                 {
-                    if (m_flags.comment_line)
+                    // m_str_token keeps only the opening of comment, and the text is thrown away
+                    bool was_commented_out = m_flags.commented_out;
+
+                    if (m_flags.comment_line && m_str_token == u8"/")
                     {
-                        if (m_str_token == U"#")
+                        if (ch == U'*')
                         {
+                            m_flags.comment_line = false;
                             m_flags.commented_out = true;
                         }
-                        else if (m_str_token == U"/")
+                        else if (ch == U'/')
                         {
-                            if (ch == U'*')
-                            {
-                                m_flags.comment_line = false;
-                                m_flags.commented_out = true;
-                            }
-                            else if (ch == U'/')
-                            {
-                                m_flags.comment_block = false;
-                                m_flags.commented_out = true;
-                            }
-                            else
-                            {
-                                m_flags.comment_line = false;
-                                m_flags.comment_block = false;
-                            }
+                            m_flags.comment_block = false;
+                            m_flags.commented_out = true;
+                        }
+                        else
+                        {
+                            m_flags.comment_line = false;
+                            m_flags.comment_block = false;
                         }
                     }
 
@@ -382,9 +566,22 @@ namespace aha::front
 
                         m_state = state::indent;
                     }
+                    else if (m_flags.comment_line && eof)
+                    {
+                        m_flags.comment_line = false;
+                        m_flags.commented_out = false;
+
+                        m_str_token.clear();
+                        m_tok_beg = pos;
+                    }
                     else if (m_flags.comment_block)
                     {
-                        if (ch == U'*' && m_str_token.size() >= 2)
+                        if (eof)
+                        {
+                            error(m_tok_beg, "unterminated comment");
+                            goto recover;
+                        }
+                        else if (ch == U'*' && was_commented_out)
                         {
                             m_flags.comment_block_might_closing = true;
                         }
@@ -411,6 +608,9 @@ namespace aha::front
                         }
                     }
 
+                    if (was_commented_out)
+                        skip = true;
+
                     if (!commented_out)
                     {
                         if (m_flags.raw_string && m_str_token.size() == 1)
@@ -418,84 +618,122 @@ namespace aha::front
                             if (ch != U'\'' && ch != U'\"')
                                 m_flags.raw_string = false;
                         }
-
-                        if (m_flags.raw_string)
+                        else if (m_flags.raw_string)
                         {
-                            if (m_str_token.size() >= 3 && m_str_token.back() == m_str_token[1] && ch != m_str_token[1])
+                            // content chars are not kept in m_str_token, so it's always '@' and the delimiter.
+                            skip = true;
+
+                            auto delimiter = m_str_token[1];
+
+                            if (ch == delimiter && !eof)
                             {
-                                auto delimiter = m_str_token[1];
+                                ++m_raw_delim_run;
+                            }
+                            else
+                            {
+                                // each pair of delimiters is an escaped delimiter, and the odd one closes the literal.
+                                m_str_payload.append(m_raw_delim_run / 2, delimiter);
 
-                                // if not escaped
-                                if ((m_str_token.size() - m_str_token.find_last_not_of(delimiter)) % 2 == 0)
+                                if (m_raw_delim_run % 2 == 1)
                                 {
                                     assert(!ret);
+                                    auto sym = takePayloadSymbol();
                                     ret = make_token(
-                                        token_raw_string { m_str_token[1], m_str_token.substr(2, m_str_token.size() - 3) },
+                                        token_raw_string { delimiter, sym, m_interner->text(sym) },
                                         src, m_tok_beg, pos);
 
                                     m_str_token.clear();
                                     m_tok_beg = pos;
                                     done = true;
+                                    skip = eof;
+                                }
+                                else if (eof)
+                                {
+                                    error(m_tok_beg, "unterminated string literal");
+                                    goto recover;
+                                }
+                                else
+                                {
+                                    append_utf8(m_str_payload, ch);
                                 }
-                            }
 
+                                m_raw_delim_run = 0;
+                            }
                         }
                         else if (m_flags.normal_string)
                         {
-                            if (ch != U' ' && (isSeperator(ch) || is_newline(ch)))
+                            skip = true;
+
+                            if (eof)
+                            {
+                                error(m_tok_beg, "unterminated string literal");
+                                goto recover;
+                            }
+                            else if (m_flags.string_escape)
+                            {
+                                if (auto msg = feedEscape(ch))
+                                {
+                                    string_error(pos, msg);
+                                    goto recover;
+                                }
+                            }
+                            else if (ch == U'\\')
                             {
-                                throwErrorWithRevert(lexer_error(src, pos,
-                                    "non-raw string literal cannot contain seperator or newline character except space"));
+                                m_flags.string_escape = true;
+                                m_escape_digits = 0;
                             }
-                            else if (ch == m_str_token[0] && m_str_token.back() != U'\\')
+                            else if (ch == m_str_token[0])
                             {
                                 assert(!ret);
+                                auto sym = takePayloadSymbol();
                                 ret = make_token(
-                                    token_normal_string { m_str_token[0], m_str_token.substr(1) },
+                                    token_normal_string { m_str_token[0], sym, m_interner->text(sym) },
                                     src, m_tok_beg, pos);
 
                                 m_str_token.clear();
                                 m_tok_beg = pos;
                                 done = true;
-                                skip = true;
                             }
-                        }
-                        else if (m_flags.interpol_string)
-                        {
-                            // TODO: bugs
-                            if (ch != U' ' && (isSeperator(ch) || is_newline(ch)))
+                            else if (ch != U' ' && (isSeperator(ch) || is_newline(ch)))
                             {
-                                throwErrorWithRevert(lexer_error(src, pos,
-                                    "non-raw string literal cannot contain seperator or newline character except space"));
+                                string_error(pos, "non-raw string literal cannot contain seperator or newline character except space");
+                                goto recover;
                             }
-                            else if ((m_str_token.size() == 1 && m_str_token[0] == U'`') || (m_str_token.size() == 2 && m_str_token[0] == U'@'))
+                            else
                             {
-                                // nothing
+                                append_utf8(m_str_payload, ch);
                             }
-                            else if (ch == U'`' && m_str_token.back() != U'\\')
-                            {
-                                assert(!ret);
-                                ret = make_token(
-                                    token_interpol_string_end { m_str_token.substr(1) },
-                                    src, m_tok_beg, pos);
+                        }
+                        else if (m_flags.interpol_string)
+                        {
+                            skip = true;
 
-                                m_flags.interpol_string_after = false;
-                                m_flags.enable_interpol_block_end = false;
+                            bool dollar = m_flags.interpol_dollar;
+                            m_flags.interpol_dollar = false;
 
-                                m_str_token.clear();
-                                m_tok_beg = pos;
-                                done = true;
-                                skip = true;
+                            if (eof)
+                            {
+                                error(m_tok_beg, "unterminated string literal");
+                                goto recover;
+                            }
+                            else if (m_flags.string_escape)
+                            {
+                                if (auto msg = feedEscape(ch))
+                                {
+                                    string_error(pos, msg);
+                                    goto recover;
+                                }
                             }
-                            else if (m_str_token.back() == U'$' && ch == U'{')
+                            else if (dollar && ch == U'{')
                             {
-                                auto str = m_str_token.substr(1, m_str_token.size() - 2);
+                                // '$' was already added
+                                m_str_payload.pop_back();
 
                                 if (m_str_token.front() == U'`')
                                 {
                                     assert(!ret);
                                     ret = make_token(
-                                        token_interpol_string_start { std::move(str) },
+                                        token_interpol_string_start { takePayload() },
                                         src, m_tok_beg, pos);
 
                                     m_flags.interpol_string_after = true;
@@ -507,14 +745,42 @@ namespace aha::front
 
                                     assert(!ret);
                                     ret = make_token(
-                                        token_interpol_string_mid { std::move(str) },
+                                        token_interpol_string_mid { takePayload() },
                                         src, m_tok_beg, pos);
                                 }
 
                                 m_str_token.clear();
                                 m_tok_beg = pos;
                                 done = true;
-                                skip = true;
+                            }
+                            else if (ch == U'\\')
+                            {
+                                m_flags.string_escape = true;
+                                m_escape_digits = 0;
+                            }
+                            else if (ch == U'`')
+                            {
+                                assert(!ret);
+                                ret = make_token(
+                                    token_interpol_string_end { takePayload() },
+                                    src, m_tok_beg, pos);
+
+                                m_flags.interpol_string_after = false;
+                                m_flags.enable_interpol_block_end = false;
+
+                                m_str_token.clear();
+                                m_tok_beg = pos;
+                                done = true;
+                            }
+                            else if (ch != U' ' && (isSeperator(ch) || is_newline(ch)))
+                            {
+                                string_error(pos, "non-raw string literal cannot contain seperator or newline character except space");
+                                goto recover;
+                            }
+                            else
+                            {
+                                m_flags.interpol_dollar = (ch == U'$');
+                                append_utf8(m_str_payload, ch);
                             }
                         }
                         else if (m_flags.identifier)
@@ -523,11 +789,11 @@ namespace aha::front
                             {
                                 assert(!ret);
 
-                                auto it1 = std::find(m_contextual_keywords.begin(), m_contextual_keywords.end(), m_str_token);
-                                if (it1 != m_contextual_keywords.end())
+                                if (m_contextual_keywords && std::find(m_contextual_keywords->begin(),
+                                    m_contextual_keywords->end(), std::u8string_view { m_str_token }) != m_contextual_keywords->end())
                                 {
                                     ret = make_token(
-                                        token_contextual_keyword { m_str_token },
+                                        token_contextual_keyword { tokenString(m_str_token) },
                                         src, m_tok_beg, pos);
                                 }
                                 else
@@ -536,13 +802,14 @@ namespace aha::front
                                     if (it2 != toks_keyword.end())
                                     {
                                         ret = make_token(
-                                            token_keyword { m_str_token },
+                                            token_keyword { tokenString(m_str_token) },
                                             src, m_tok_beg, pos);
                                     }
                                     else
                                     {
+                                        auto sym = m_interner->intern(m_str_token);
                                         ret = make_token(
-                                            token_identifier { m_str_token },
+                                            token_identifier { sym, m_interner->text(sym) },
                                             src, m_tok_beg, pos);
                                     }
                                 }
@@ -570,7 +837,7 @@ namespace aha::front
                             {
                                 m_flags.decimal = true;
                             }
-                            else if (ch == U'.' || ch == U'e')
+                            else if (ch == U'.' || ch == U'e' || ch == U'E')
                             {
                                 // decimal floating-point
                                 m_flags.decimal = true;
@@ -585,7 +852,11 @@ namespace aha::front
                             }
                             else
                             {
-                                throwErrorWithRevert(lexer_error(src, pos, "unexpected character"));
+                                // '0' alone, ended by ch as any decimal literal is
+                                m_flags.decimal = true;
+
+                                m_flags.unknown_number = false;
+                                goto decimal_floating;
                             }
                             m_flags.unknown_number = false;
                         }
@@ -593,20 +864,24 @@ namespace aha::front
                         {
                         decimal_floating:
 
-                            std::u32string_view exp_chars = m_flags.decimal ? U"eE" : U"pP";
-                            std::u32string_view num_chars;
+                            std::u8string_view exp_chars = m_flags.decimal ? u8"eE" : u8"pP";
+                            std::u8string_view num_chars;
                             if (m_flags.binary)
-                                num_chars = U"01";
+                                num_chars = u8"01";
                             else if (m_flags.octal)
-                                num_chars = U"01234567";
+                                num_chars = u8"01234567";
                             else if (m_flags.decimal)
-                                num_chars = U"0123456789";
+                                num_chars = u8"0123456789";
                             else if (m_flags.heximal)
-                                num_chars = U"0123456789ABCDEFabcdef";
+                                num_chars = u8"0123456789ABCDEFabcdef";
 
                             if (m_idx_num_postfix == -1)
                             {
-                                if (num_chars.find(ch) != std::u32string_view::npos)
+                                // exponent is always decimal
+                                if (m_idx_float_exp != -1)
+                                    num_chars = u8"0123456789";
+
+                                if (contains(num_chars, ch))
                                 {
                                     // okay
                                 }
@@ -621,13 +896,13 @@ namespace aha::front
                                         done = true;
                                     }
                                 }
-                                else if (m_idx_float_exp == -1 && exp_chars.find(ch) != std::u32string_view::npos)
+                                else if (m_idx_float_exp == -1 && contains(exp_chars, ch))
                                 {
                                     m_idx_float_exp = m_str_token.size();
                                 }
-                                else if (isIdentifierFirstChar(ch))
+                                else if (m_idx_float_exp == m_str_token.size() - 1 && (ch == U'+' || ch == U'-'))
                                 {
-                                    m_idx_num_postfix = m_str_token.size();
+                                    // sign of exponent
                                 }
                                 else if (m_idx_float_exp == m_str_token.size() - 1 && isIdentifierChar(ch))
                                 {
@@ -635,6 +910,10 @@ namespace aha::front
                                     m_idx_num_postfix = m_idx_float_exp;
                                     m_idx_float_exp = -1;
                                 }
+                                else if (isIdentifierFirstChar(ch))
+                                {
+                                    m_idx_num_postfix = m_str_token.size();
+                                }
                                 else
                                 {
                                     done = true;
@@ -642,10 +921,11 @@ namespace aha::front
 
                                 if (done)
                                 {
-                                    std::u32string_view prefix = U"bBcCdDxX";
-                                    if (m_str_token.size() == 2 && m_str_token[0] == U'0' && prefix.find(m_str_token[1]) != std::u32string_view::npos)
+                                    std::u8string_view prefix = u8"bBcCdDxX";
+                                    if (m_str_token.size() == 2 && m_str_token[0] == u8'0' && contains(prefix, m_str_token[1]))
                                     {
-                                        throwErrorWithRevert(lexer_error(src, pos, "unexpected end of number literal"));
+                                        error(pos, "unexpected end of number literal");
+                                        goto recover;
                                     }
                                 }
                             }
@@ -676,7 +956,8 @@ namespace aha::front
                                     else if (m_flags.heximal && (m_str_token[1] == U'x' || m_str_token[1] == U'X'))
                                         prefix = true;
 
-                                    beg1 = 2;
+                                    if (prefix)
+                                        beg1 = 2;
                                 }
 
                                 if (m_idx_float_sep != -1)
@@ -723,23 +1004,73 @@ namespace aha::front
                                 else // if (m_flags.heximal)
                                     radix = 16;
 
-                                auto substr8 = [](std::u32string_view str, std::size_t pos, std::size_t count) {
-                                    auto sub = str.substr(pos, count);
-
-                                    auto fn = [](char32_t ch) { return static_cast<char>(ch); };
-                                    auto tbeg = boost::iterators::make_transform_iterator(sub.begin(), fn);
-                                    auto tend = boost::iterators::make_transform_iterator(sub.end(), fn);
-
-                                    return std::string(tbeg, tend);
-                                };
+                                std::u8string_view str = m_str_token;
+                                auto integer = str.substr(beg1, end1 - beg1);
+                                auto fraction = str.substr(beg2, end2 - beg2);
+                                auto exponent = str.substr(beg3, end3 - beg3);
+                                auto postfix = str.substr(beg4);
 
                                 token_number tn;
                                 tn.radix = radix;
-                                tn.integer = substr8(m_str_token, beg1, end1 - beg1);
-                                tn.fraction = substr8(m_str_token, beg2, end2 - beg2);
-                                tn.exponent = substr8(m_str_token, beg3, end3 - beg3);
-                                tn.postfix = substr8(m_str_token, beg4, std::u32string_view::npos);
                                 tn.is_float = is_float;
+                                tn.integer = 0;
+                                tn.floating = 0;
+
+                                if (!parse_number_postfix(postfix, tn.postfix))
+                                {
+                                    error(m_tok_beg, "invalid postfix of number literal");
+                                    goto recover;
+                                }
+
+                                if (tn.postfix == number_postfix::f || tn.postfix == number_postfix::d)
+                                    tn.is_float = true;
+                                else if (tn.is_float && tn.postfix != number_postfix::none)
+                                {
+                                    error(m_tok_beg, "floating-point literal cannot have integer postfix");
+                                    goto recover;
+                                }
+
+                                if (integer.empty() && fraction.empty())
+                                {
+                                    error(m_tok_beg, "number literal has no digits");
+                                    goto recover;
+                                }
+
+                                if (!tn.is_float)
+                                {
+                                    if (!numconv::parse_integer(integer, radix, tn.integer))
+                                    {
+                                        error(m_tok_beg, "integer literal is too large");
+                                        goto recover;
+                                    }
+
+                                    if ((tn.postfix == number_postfix::u && tn.integer > std::numeric_limits<std::uint32_t>::max())
+                                        || (tn.postfix == number_postfix::l && tn.integer > std::numeric_limits<std::int64_t>::max()))
+                                    {
+                                        error(m_tok_beg, "integer literal is out of range of its type");
+                                        goto recover;
+                                    }
+                                }
+                                else
+                                {
+                                    std::int64_t exp = 0;
+                                    if (m_idx_float_exp != -1 && !numconv::parse_exponent(exponent, exp))
+                                    {
+                                        error(m_tok_beg, "exponent of number literal has no digits");
+                                        goto recover;
+                                    }
+
+                                    bool single = (tn.postfix == number_postfix::f);
+
+                                    bool in_range = (radix == 10)
+                                        ? numconv::parse_decimal_float(integer, fraction, exp, single, tn.floating)
+                                        : numconv::parse_binary_float(integer, fraction, radix, exp, single, tn.floating);
+                                    if (!in_range)
+                                    {
+                                        error(m_tok_beg, "floating-point literal is out of range");
+                                        goto recover;
+                                    }
+                                }
 
                                 assert(!ret);
                                 ret = make_token(std::move(tn), src, m_tok_beg, pos);
@@ -750,37 +1081,41 @@ namespace aha::front
                         }
                         else if (m_flags.punct)
                         {
-                            if (punct_chars.find(ch) == std::u32string_view::npos)
+                            if (!contains(punct_chars, ch))
                                 done = true;
 
                             if (!m_str_token.empty())
                             {
-                                std::u32string_view matched;
-                                unsigned candidates = 0;
-
-                                for (auto str : toks_punct)
+                                // m_str_token is at most one character longer than the longest punctuator,
+                                // so this costs a few binary searches per character.
+                                std::u8string_view str = m_str_token;
+                                auto tbeg = toks_punct_sorted.begin(), tend = toks_punct_sorted.end();
+
+                                // longest punctuator which is a prefix of m_str_token
+                                std::u8string_view matched;
+                                for (auto len = str.size(); len > 0; --len)
                                 {
-                                    int sz = std::min(m_str_token.size(), str.size());
-                                    if (m_str_token.compare(0, sz, str, 0, sz) == 0)
+                                    auto it = std::lower_bound(tbeg, tend, str.substr(0, len));
+                                    if (it != tend && *it == str.substr(0, len))
                                     {
-                                        if (m_str_token.size() >= str.size())
-                                        {
-                                            if (str.size() >= matched.size())
-                                            {
-                                                matched = str;
-                                            }
-                                        }
-                                        else
-                                        {
-                                            ++candidates;
-                                        }
+                                        matched = *it;
+                                        break;
                                     }
                                 }
 
-                                if (done || candidates == 0)
+                                // whether m_str_token might grow into a longer punctuator
+                                auto it = std::lower_bound(tbeg, tend, str);
+                                if (it != tend && *it == str)
+                                    ++it;
+                                bool candidates = (it != tend && it->starts_with(str));
+
+                                if (done || !candidates)
                                 {
                                     if (matched.empty())
-                                        throwErrorWithRevert(lexer_error(src, m_tok_beg, "unexpected character"));
+                                    {
+                                        error(m_tok_beg, "unexpected character");
+                                        goto recover;
+                                    }
 
                                     assert(!ret);
 
@@ -789,7 +1124,7 @@ namespace aha::front
                                         tok_end = tok_end.next(src);
 
                                     ret = make_token(
-                                        token_punct { std::u32string { matched } },
+                                        token_punct { tokenString(matched) },
                                         src, m_tok_beg, tok_end);
 
                                     m_str_token.erase(m_str_token.begin(), m_str_token.begin() + matched.size());
@@ -817,20 +1152,56 @@ namespace aha::front
 
                     m_state = state::indent;
                 }
-                else if (!isSeperator(ch))
+                else if (isSeperator(ch))
+                {
+                    skip = true;
+                }
+                else
+                {
+                    error(pos, "the line which contains the end of multi-line comment must be empty");
+                    goto recover;
+                }
+            }
+            else if (m_state == state::recover)
+            {
+                // skip the erroneous input up to the next seperator or newline
+                if (eof || isSeperator(ch) || ch == U'\n')
                 {
-                    throwErrorWithRevert(lexer_error(src, pos, "the line which contains the end of multi-line comment must be empty"));
+                    assert(!ret);
+                    ret = make_token(
+                        token_error { m_error_msg },
+                        src, m_error_beg, pos);
+
+                    m_tok_beg = pos;
+                    done = true;
+
+                    m_state = state::any;
+                }
+                else
+                {
+                    skip = true;
                 }
             }
 
             if (!skip)
-                m_str_token.push_back(ch);
+                append_utf8(m_str_token, ch);
 
             if (done)
+                rebuffer();
+
+        recover:
+            if (ret && m_flags.trivia)
             {
-                m_buf_beg = m_tok_beg;
-                m_buf.insert(m_buf.begin(), m_str_token.begin(), m_str_token.end());
-                m_str_token.clear();
+                // the token text ends where the next unread character is.
+                // a newline token is only the newline; a comment before it is trivia.
+                auto text_end = m_buf.empty() ? src.getEndpoint() : m_buf_beg;
+                auto text_beg = ret->beg;
+                if (std::holds_alternative<token_newline>(ret->data))
+                    text_beg = eof ? text_end : pos;
+
+                ret->leading_trivia = { m_text_end, text_beg };
+                ret->trailing_trivia = { text_end, text_end };
+                m_text_end = text_end;
             }
         }
 
@@ -838,6 +1209,195 @@ namespace aha::front
         return ret;
     }
 
+    void lexer::rebuffer()
+    {
+        std::u32string chars;
+        chars.reserve(m_str_token.size());
+
+        for (std::size_t i = 0; i < m_str_token.size(); )
+        {
+            char32_t ch;
+            i += decode_utf8(m_str_token, i, ch);
+            chars.push_back(ch);
+        }
+
+        m_buf_beg = m_tok_beg;
+        m_buf.insert(m_buf.begin(), chars.begin(), chars.end());
+        m_str_token.clear();
+
+        AHA_FRONT_COUNT(m_stats, rebuffered_chars += chars.size());
+    }
+
+    void lexer::scanRun(source& src)
+    {
+        auto bytes = src.peekBytes();
+        auto beg = bytes.data();
+        auto end = beg + bytes.size();
+
+        if (beg == end)
+            return;
+
+        auto append = [this, &src, beg](const char* run_end) {
+            auto count = static_cast<std::size_t>(run_end - beg);
+            if (count != 0)
+            {
+                m_str_token.append(reinterpret_cast<const char8_t*>(beg), count);
+                src.skipBytes(count);
+            }
+        };
+
+        if (m_state == state::indent)
+        {
+            // the first character goes through lex() to mark the beginning of token
+            if (!m_str_token.empty())
+                append(scan::blank_run(beg, end));
+        }
+        else if (m_state == state::any || m_state == state::after_comment)
+        {
+            bool number = m_flags.binary || m_flags.octal || m_flags.decimal || m_flags.heximal;
+
+            if (m_str_token.empty())
+            {
+                src.skipBytes(scan::blank_run(beg, end) - beg);
+            }
+            else if (m_flags.commented_out)
+            {
+                // a possible end of block comment is left to lex(), as it needs the next character.
+                // newlines, tabs and non-ASCII characters also stop the search.
+                if (m_flags.comment_line)
+                    src.skipBytes(scan::until_special(beg, end, '\n', '\n', '\n') - beg);
+                else if (!m_flags.comment_block_might_closing)
+                    src.skipBytes(scan::until_special(beg, end, '*', '*', '*') - beg);
+            }
+            else if (m_flags.identifier || (number && m_idx_num_postfix != -1))
+            {
+                append(scan::identifier_run(beg, end));
+            }
+            else if (number && !m_flags.unknown_number)
+            {
+                unsigned radix;
+                if (m_flags.binary)
+                    radix = 2;
+                else if (m_flags.octal)
+                    radix = 8;
+                else if (m_flags.decimal)
+                    radix = 10;
+                else
+                    radix = 16;
+
+                // exponent is always decimal
+                if (m_idx_float_exp != -1)
+                    radix = 10;
+
+                append(scan::digit_run(beg, end, radix));
+            }
+            else
+            {
+                scanStringBody(src);
+            }
+        }
+    }
+
+    void lexer::scanStringBody(source& src)
+    {
+        char a, b, c;
+
+        if (m_flags.raw_string && m_str_token.size() == 2 && m_raw_delim_run == 0)
+        {
+            a = b = c = static_cast<char>(m_str_token[1]);
+        }
+        else if (m_flags.normal_string && !m_flags.string_escape)
+        {
+            a = static_cast<char>(m_str_token[0]);
+            b = c = '\\';
+        }
+        else if (m_flags.interpol_string && !m_flags.string_escape && !m_flags.interpol_dollar)
+        {
+            a = '`';
+            b = '\\';
+            c = '$';
+        }
+        else
+        {
+            return;
+        }
+
+        auto bytes = src.peekBytes();
+        auto end = scan::until_special(bytes.data(), bytes.data() + bytes.size(), a, b, c);
+        auto count = static_cast<std::size_t>(end - bytes.data());
+
+        if (count != 0)
+        {
+            m_str_payload.append(reinterpret_cast<const char8_t*>(bytes.data()), count);
+            src.skipBytes(count);
+        }
+    }
+
+    const char* lexer::feedEscape(char32_t ch)
+    {
+        if (m_escape_digits == 0)
+        {
+            char32_t decoded;
+            switch (ch)
+            {
+                case U'0': decoded = U'\0'; break;
+                case U'a': decoded = U'\a'; break;
+                case U'b': decoded = U'\b'; break;
+                case U'f': decoded = U'\f'; break;
+                case U'n': decoded = U'\n'; break;
+                case U'r': decoded = U'\r'; break;
+                case U't': decoded = U'\t'; break;
+                case U'v': decoded = U'\v'; break;
+                case U'\\': case U'\'': case U'\"': case U'`':
+                case U'$': case U'{': case U'}':
+                    decoded = ch;
+                    break;
+
+                case U'x': m_escape_digits = 2; break;
+                case U'u': m_escape_digits = 4; break;
+                case U'U': m_escape_digits = 8; break;
+
+                default:
+                    return "invalid escape sequence";
+            }
+
+            if (m_escape_digits == 0)
+            {
+                append_utf8(m_str_payload, decoded);
+                m_flags.string_escape = false;
+            }
+            else
+            {
+                m_escape_value = 0;
+            }
+        }
+        else
+        {
+            unsigned digit;
+            if (U'0' <= ch && ch <= U'9')
+                digit = ch - U'0';
+            else if (U'a' <= ch && ch <= U'f')
+                digit = ch - U'a' + 10;
+            else if (U'A' <= ch && ch <= U'F')
+                digit = ch - U'A' + 10;
+            else
+                return "invalid escape sequence";
+
+            m_escape_value = m_escape_value * 16 + digit;
+
+            if (--m_escape_digits == 0)
+            {
+                if (m_escape_value > 0x10ffff || (0xd800 <= m_escape_value && m_escape_value <= 0xdfff))
+                    return "escape sequence is not a valid unicode code point";
+
+                append_utf8(m_str_payload, m_escape_value);
+                m_flags.string_escape = false;
+            }
+        }
+
+        return nullptr;
+    }
+
     lex_result lexer::getLastResult() const
     {
         return m_last_result;
@@ -851,11 +1411,69 @@ namespace aha::front
         m_flags.enable_interpol_block_end = enable;
     }
 
-    void lexer::setContextualKeyword(std::vector<std::u32string> keywords)
+    void lexer::setContextualKeyword(std::vector<std::u8string> keywords)
+    {
+        m_contextual_keywords = std::make_shared<const std::vector<std::u8string>>(std::move(keywords));
+    }
+
+    void lexer::setContextualKeyword(std::shared_ptr<const std::vector<std::u8string>> keywords)
     {
         m_contextual_keywords = std::move(keywords);
     }
 
+    void lexer::setDiagnostics(diagnostics* diag)
+    {
+        m_diagnostics = diag;
+    }
+
+    void lexer::enableTrivia(bool enable)
+    {
+        m_flags.trivia = enable;
+    }
+
+    void lexer::setStats(front_stats* stats)
+    {
+        m_stats = stats;
+    }
+
+    void lexer::setTokenResource(std::pmr::memory_resource* resource)
+    {
+        m_token_resource = resource ? resource : m_resource;
+    }
+
+    void lexer::setInterner(string_interner* interner)
+    {
+        m_interner = interner ? interner : &string_interner::global();
+    }
+
+    void lexer::setIndentation(std::u8string_view indent, std::span<const std::size_t> widths)
+    {
+        assert(widths.empty() || widths.back() == indent.size());
+
+        m_indent_str.assign(indent);
+        m_indent_pos.assign(widths.begin(), widths.end());
+    }
+
+    std::pmr::u8string lexer::tokenString(std::u8string_view str) const
+    {
+        return std::pmr::u8string(str, m_token_resource);
+    }
+
+    // copied rather than moved, so that the payload keeps its capacity and the token gets its resource
+    std::pmr::u8string lexer::takePayload()
+    {
+        auto str = tokenString(m_str_payload);
+        m_str_payload.clear();
+        return str;
+    }
+
+    symbol_id lexer::takePayloadSymbol()
+    {
+        auto sym = m_interner->intern(m_str_payload);
+        m_str_payload.clear();
+        return sym;
+    }
+
     bool lexer::isSeperator(char32_t ch)
     {
         return u_isblank(ch);
@@ -0,0 +1,91 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/memory.hpp"
+
+namespace aha::front
+{
+    counting_resource::counting_resource(std::pmr::memory_resource* upstream)
+        : m_upstream(upstream)
+    {
+        reset();
+    }
+
+    std::pmr::memory_resource* counting_resource::getUpstream() const
+    {
+        return m_upstream;
+    }
+
+    std::uint64_t counting_resource::getAllocations() const
+    {
+        return m_allocations;
+    }
+
+    std::uint64_t counting_resource::getAllocatedBytes() const
+    {
+        return m_allocated_bytes;
+    }
+
+    std::size_t counting_resource::getLiveBytes() const
+    {
+        return m_live_bytes;
+    }
+
+    std::size_t counting_resource::getPeakBytes() const
+    {
+        return m_peak_bytes;
+    }
+
+    void counting_resource::reset()
+    {
+        m_allocations = 0;
+        m_allocated_bytes = 0;
+        m_live_bytes = 0;
+        m_peak_bytes = 0;
+    }
+
+    void* counting_resource::do_allocate(std::size_t bytes, std::size_t alignment)
+    {
+        auto p = m_upstream->allocate(bytes, alignment);
+
+        ++m_allocations;
+        m_allocated_bytes += bytes;
+        m_live_bytes += bytes;
+        m_peak_bytes = std::max(m_peak_bytes, m_live_bytes);
+
+        return p;
+    }
+
+    void counting_resource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+    {
+        m_upstream->deallocate(p, bytes, alignment);
+
+        // memory from before reset() may come back
+        m_live_bytes -= std::min(m_live_bytes, bytes);
+    }
+
+    bool counting_resource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+    {
+        return this == &other;
+    }
+}
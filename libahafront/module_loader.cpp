@@ -0,0 +1,418 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/module_loader.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include "aha/front/token_cache.hpp"
+#include "aha/front/trace.hpp"
+
+namespace
+{
+    using namespace aha::front;
+
+    constexpr std::size_t no_module = SIZE_MAX;
+
+    // the same file however it is reached
+    std::string path_key(const std::filesystem::path& path)
+    {
+        return std::filesystem::absolute(path).lexically_normal().string();
+    }
+
+    std::string import_name(const ast& tree, node_id id)
+    {
+        std::string name;
+        for (auto child : tree.children(id))
+        {
+            auto text = tree.text(child);
+            if (!name.empty())
+                name += '.';
+            name.append(reinterpret_cast<const char*>(text.data()), text.size());
+        }
+        return name;
+    }
+}
+
+namespace aha::front
+{
+    struct module_loader::load_entry
+    {
+        std::filesystem::path path;
+        std::shared_ptr<const module_unit> unit;
+
+        // as unit->imports; no_module if not found
+        std::vector<std::size_t> imports;
+        std::vector<import_error> errors;
+    };
+
+    struct module_loader::load_state
+    {
+        std::mutex mutex;
+        // a deque, since entries are added while tasks refer to theirs
+        std::deque<load_entry> entries;
+        std::unordered_map<std::string, std::size_t> index;
+    };
+
+    module_loader::module_loader(thread_pool& pool, std::vector<std::filesystem::path> search_paths)
+        : m_pool(pool), m_search_paths(std::move(search_paths)), m_workers(pool.size()), m_parsed(0), m_stats(nullptr)
+    {
+        for (auto& w : m_workers)
+        {
+            w.ll.setDiagnostics(&w.lexer_diag);
+            w.yy.setDiagnostics(&w.parser_diag);
+            w.yy.setLazyBodies(true);
+        }
+    }
+
+    module_loader::~module_loader() = default;
+
+    module_graph module_loader::load(std::span<const std::filesystem::path> files)
+    {
+        load_state state;
+        m_parsed = 0;
+
+        std::vector<std::size_t> roots;
+        for (auto& file : files)
+            roots.push_back(addModule(state, file));
+
+        m_pool.wait();
+
+        if (m_stats)
+        {
+            for (auto& w : m_workers)
+            {
+                m_stats->merge(w.stats);
+                w.stats = front_stats();
+            }
+        }
+
+        // the rest walks the graph from the files in order, so does not depend on the order of loading
+        trace_span span("module graph");
+
+        auto& entries = state.entries;
+        module_graph ret;
+
+        // 0: not reached, 1: on the path from the file, 2: done
+        std::vector<std::uint8_t> color(entries.size(), 0);
+        std::vector<std::size_t> result_index(entries.size(), no_module);
+
+        struct frame
+        {
+            std::size_t idx;
+            std::size_t next;
+        };
+        std::vector<frame> stack;
+
+        auto reach = [&](std::size_t idx) {
+            color[idx] = 1;
+            stack.push_back({ idx, 0 });
+            ret.errors.insert(ret.errors.end(), entries[idx].errors.begin(), entries[idx].errors.end());
+        };
+
+        for (auto root : roots)
+        {
+            if (color[root] == 0)
+                reach(root);
+
+            while (!stack.empty())
+            {
+                auto idx = stack.back().idx;
+                auto& entry = entries[idx];
+
+                if (stack.back().next == entry.imports.size())
+                {
+                    color[idx] = 2;
+                    if (entry.unit)
+                    {
+                        result_index[idx] = ret.modules.size();
+                        ret.modules.push_back(entry.unit);
+                    }
+
+                    stack.pop_back();
+                    continue;
+                }
+
+                auto imp = stack.back().next++;
+                auto target = entry.imports[imp];
+
+                if (target == no_module)
+                    continue;
+
+                if (color[target] == 0)
+                {
+                    reach(target);
+                }
+                else if (color[target] == 1)
+                {
+                    std::string message = "import cycle: ";
+
+                    auto it = std::find_if(stack.begin(), stack.end(), [&](const frame& f) { return f.idx == target; });
+                    for (; it != stack.end(); ++it)
+                        message += entries[it->idx].path.string() + " -> ";
+                    message += entries[target].path.string();
+
+                    ret.errors.push_back({ entry.path, entry.unit->imports[imp].pos, std::move(message) });
+                }
+            }
+        }
+
+        ret.imports.resize(ret.modules.size());
+        for (std::size_t idx = 0; idx < entries.size(); ++idx)
+        {
+            if (result_index[idx] == no_module)
+                continue;
+
+            auto& imports = ret.imports[result_index[idx]];
+            for (auto target : entries[idx].imports)
+            {
+                if (target != no_module && result_index[target] != no_module)
+                    imports.push_back(result_index[target]);
+            }
+        }
+
+        return ret;
+    }
+
+    void module_loader::setLazyBodies(bool lazy)
+    {
+        for (auto& w : m_workers)
+            w.yy.setLazyBodies(lazy);
+
+        clearCache();
+    }
+
+    void module_loader::setStats(front_stats* stats)
+    {
+        m_stats = stats;
+    }
+
+    std::size_t module_loader::getParsedCount() const
+    {
+        return m_parsed;
+    }
+
+    void module_loader::clearCache()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cache.clear();
+    }
+
+    // returns the index of the module, which is loaded on the pool when first added
+    std::size_t module_loader::addModule(load_state& state, const std::filesystem::path& path)
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        auto [it, added] = state.index.emplace(path_key(path), state.entries.size());
+        if (added)
+        {
+            auto& entry = state.entries.emplace_back();
+            entry.path = path;
+
+            m_pool.submit([this, &state, &entry](unsigned worker) {
+                loadModule(state, entry, worker);
+            });
+        }
+
+        return it->second;
+    }
+
+    void module_loader::loadModule(load_state& state, load_entry& entry, unsigned worker)
+    {
+        trace_span span("load module", [&] { return entry.path.string(); });
+
+        std::string content;
+        {
+            std::ifstream file(entry.path, std::ios::binary);
+            if (!file)
+            {
+                entry.errors.push_back({ entry.path, { 0, 0 }, "cannot open file" });
+                return;
+            }
+
+            content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        auto key = path_key(entry.path);
+        auto hash = hash_source(content);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_cache.find(key);
+            if (it != m_cache.end() && it->second->content_hash == hash && it->second->path == entry.path)
+                entry.unit = it->second;
+        }
+
+        if (!entry.unit)
+        {
+            try
+            {
+                entry.unit = parseModule(entry.path, std::move(content), hash, m_workers[worker]);
+            }
+            catch (source_positional_error& ex)
+            {
+                entry.errors.push_back({ entry.path, ex.getPosition(), ex.what() });
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cache[key] = entry.unit;
+            ++m_parsed;
+        }
+
+        // the imports are resolved again, since the search paths may have other files now
+        for (auto& imp : entry.unit->imports)
+        {
+            auto path = findModule(imp.name);
+            if (path.empty())
+            {
+                entry.imports.push_back(no_module);
+                entry.errors.push_back({ entry.path, imp.pos, "cannot find module '" + imp.name + "'" });
+            }
+            else
+            {
+                entry.imports.push_back(addModule(state, path));
+            }
+        }
+    }
+
+    std::shared_ptr<const module_unit> module_loader::parseModule(const std::filesystem::path& path, std::string content,
+        std::uint64_t hash, worker& w)
+    {
+        auto unit = std::make_shared<module_unit>();
+        unit->path = path;
+        unit->content_hash = hash;
+
+        unit->src = std::make_unique<repl_source>(path.string());
+        unit->src->feedString(content);
+        unit->src->feedEof();
+
+        unit->memory = std::make_unique<counting_resource>();
+
+        w.ll.clearAll();
+        w.ll.setTokenResource(unit->memory.get());
+        w.lexer_diag.clear();
+
+        w.ll.setStats(m_stats ? &w.stats : nullptr);
+        unit->src->setStats(m_stats ? &w.stats : nullptr);
+        w.yy.setModuleResource(unit->memory.get());
+        w.yy.clearAll();
+        w.parser_diag.clear();
+
+        {
+            trace_span span("lex", unit->src->getName());
+            while (auto tok = w.ll.lex(*unit->src))
+                unit->tokens.push_back(std::move(*tok));
+
+            // the source outlives this load()
+            unit->src->setStats(nullptr);
+        }
+
+        {
+            trace_span span("parse", unit->src->getName());
+            for (auto& tok : unit->tokens)
+                w.yy.parse(tok);
+            w.yy.finish();
+        }
+
+        unit->tree = w.yy.takeModule();
+
+        w.ll.setTokenResource(nullptr);
+        w.yy.setModuleResource(nullptr);
+        w.yy.clearAll();
+
+        if (m_stats)
+        {
+            w.stats.allocations += unit->memory->getAllocations();
+            w.stats.allocated_bytes += unit->memory->getAllocatedBytes();
+        }
+        unit->lexer_errors = w.lexer_diag.get();
+        unit->parser_errors = w.parser_diag.get();
+
+        auto& tree = unit->tree;
+        for (auto id : tree.children(tree.root()))
+        {
+            if (tree[id].kind == node_kind::import)
+                unit->imports.push_back({ import_name(tree, id), tree[id].beg });
+        }
+
+        return unit;
+    }
+
+    // empty if none
+    std::filesystem::path module_loader::findModule(const std::string& name) const
+    {
+        std::filesystem::path relative;
+        std::size_t beg = 0;
+
+        while (true)
+        {
+            auto end = name.find('.', beg);
+            relative /= name.substr(beg, end - beg);
+            if (end == std::string::npos)
+                break;
+            beg = end + 1;
+        }
+        relative += ".aha";
+
+        for (auto& dir : m_search_paths)
+        {
+            std::error_code ec;
+            auto path = dir / relative;
+            if (std::filesystem::is_regular_file(path, ec))
+                return path;
+        }
+
+        return { };
+    }
+
+    std::vector<std::filesystem::path> collect_files(std::span<const std::string> inputs)
+    {
+        namespace fs = std::filesystem;
+        std::vector<fs::path> files;
+
+        for (auto& input : inputs)
+        {
+            std::error_code ec;
+
+            if (fs::is_directory(input, ec))
+            {
+                for (auto& entry : fs::recursive_directory_iterator(input, fs::directory_options::skip_permission_denied, ec))
+                {
+                    if (entry.is_regular_file(ec) && entry.path().extension() == ".aha")
+                        files.push_back(entry.path());
+                }
+            }
+            else
+            {
+                files.push_back(input);
+            }
+        }
+
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+}
@@ -0,0 +1,481 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "numconv.h"
+
+#include <bit>
+#include <charconv>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+#include "pow5_table.h"
+
+namespace
+{
+    using namespace aha::front::numconv;
+
+    struct uint128
+    {
+        std::uint64_t high;
+        std::uint64_t low;
+    };
+
+    uint128 full_multiplication(std::uint64_t a, std::uint64_t b)
+    {
+#if defined(__SIZEOF_INT128__)
+        auto r = static_cast<unsigned __int128>(a) * b;
+        return { static_cast<std::uint64_t>(r >> 64), static_cast<std::uint64_t>(r) };
+#elif defined(_MSC_VER) && defined(_M_X64)
+        std::uint64_t high;
+        std::uint64_t low = _umul128(a, b, &high);
+        return { high, low };
+#else
+        std::uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+        std::uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+
+        std::uint64_t lo_lo = a_lo * b_lo;
+        std::uint64_t hi_lo = a_hi * b_lo;
+        std::uint64_t lo_hi = a_lo * b_hi;
+        std::uint64_t hi_hi = a_hi * b_hi;
+
+        std::uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+        return { (hi_lo >> 32) + (cross >> 32) + hi_hi, (cross << 32) | (lo_lo & 0xffffffff) };
+#endif
+    }
+
+    int digit_value(char8_t ch)
+    {
+        if (u8'0' <= ch && ch <= u8'9')
+            return ch - u8'0';
+        else if (u8'a' <= ch && ch <= u8'f')
+            return ch - u8'a' + 10;
+        else if (u8'A' <= ch && ch <= u8'F')
+            return ch - u8'A' + 10;
+        else
+            return -1;
+    }
+
+    struct float_format
+    {
+        int mantissa_bits;          // explicit bits of significand
+        int min_exponent;           // -bias
+        int infinite_power;         // biased exponent of infinity
+        int min_round_to_even;      // range of q where exact ties are possible
+        int max_round_to_even;
+        int smallest_power_of_ten;  // below this, the value is always zero
+        int largest_power_of_ten;   // above this, the value is always infinity
+        int max_exact_power_of_ten; // 10^q is exact in this format
+    };
+
+    constexpr float_format binary64 { 52, -1023, 0x7ff, -4, 23, -342, 308, 22 };
+    constexpr float_format binary32 { 23, -127, 0xff, -17, 10, -64, 38, 10 };
+
+    constexpr double exact_pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    struct adjusted_mantissa
+    {
+        std::uint64_t mantissa;
+        int power2; // biased exponent
+    };
+
+    // Eisel-Lemire: w * 10^q with w != 0, rounded to nearest even.
+    // returns false in the (very rare) case that 128-bit precision cannot decide the result.
+    bool eisel_lemire(std::uint64_t w, std::int64_t q, const float_format& fmt, adjusted_mantissa& am)
+    {
+        if (q < fmt.smallest_power_of_ten)
+        {
+            am = { 0, 0 };
+            return true;
+        }
+        if (q > fmt.largest_power_of_ten)
+        {
+            am = { 0, fmt.infinite_power };
+            return true;
+        }
+
+        int lz = std::countl_zero(w);
+        w <<= lz;
+
+        const auto& pow5 = pow5_table[q - pow5_table_min];
+        auto product = full_multiplication(w, pow5.high);
+
+        std::uint64_t precision_mask = ~std::uint64_t(0) >> (fmt.mantissa_bits + 3);
+        if ((product.high & precision_mask) == precision_mask)
+        {
+            auto second = full_multiplication(w, pow5.low);
+            product.low += second.high;
+            if (second.high > product.low)
+                ++product.high;
+
+            // 5^q is exact (or its reciprocal is exact enough) only in this range
+            if (product.low == ~std::uint64_t(0) && !(-27 <= q && q <= 55))
+                return false;
+        }
+
+        int upperbit = static_cast<int>(product.high >> 63);
+        int shift = upperbit + 64 - fmt.mantissa_bits - 3;
+
+        am.mantissa = product.high >> shift;
+        // floor(q * log2(10)) + 63
+        am.power2 = static_cast<int>((((152170 + 65536) * q) >> 16) + 63 + upperbit - lz - fmt.min_exponent);
+
+        if (am.power2 <= 0)
+        {
+            // subnormal
+            if (-am.power2 + 1 >= 64)
+            {
+                am = { 0, 0 };
+                return true;
+            }
+
+            am.mantissa >>= -am.power2 + 1;
+            am.mantissa += (am.mantissa & 1);
+            am.mantissa >>= 1;
+            am.power2 = (am.mantissa < (std::uint64_t(1) << fmt.mantissa_bits)) ? 0 : 1;
+            return true;
+        }
+
+        // exactly halfway: round to even rather than up
+        if (product.low <= 1 && fmt.min_round_to_even <= q && q <= fmt.max_round_to_even
+            && (am.mantissa & 3) == 1 && (am.mantissa << shift) == product.high)
+        {
+            am.mantissa &= ~std::uint64_t(1);
+        }
+
+        am.mantissa += (am.mantissa & 1);
+        am.mantissa >>= 1;
+        if (am.mantissa >= (std::uint64_t(2) << fmt.mantissa_bits))
+        {
+            am.mantissa = std::uint64_t(1) << fmt.mantissa_bits;
+            ++am.power2;
+        }
+        am.mantissa &= ~(std::uint64_t(1) << fmt.mantissa_bits);
+
+        if (am.power2 >= fmt.infinite_power)
+            am = { 0, fmt.infinite_power };
+
+        return true;
+    }
+
+    double to_double(adjusted_mantissa am, bool single)
+    {
+        if (single)
+        {
+            auto bits = static_cast<std::uint32_t>(am.mantissa | (std::uint64_t(am.power2) << binary32.mantissa_bits));
+            return std::bit_cast<float>(bits);
+        }
+        else
+        {
+            auto bits = am.mantissa | (std::uint64_t(am.power2) << binary64.mantissa_bits);
+            return std::bit_cast<double>(bits);
+        }
+    }
+
+    // slow path for the inputs the fast algorithms cannot decide
+    bool parse_decimal_fallback(std::u8string_view integer, std::u8string_view fraction,
+        std::int64_t exp10, bool single, double& value)
+    {
+        std::string str;
+        str.reserve(integer.size() + fraction.size() + 24);
+        for (auto ch : integer)
+            str += static_cast<char>(ch);
+        str += '.';
+        for (auto ch : fraction)
+            str += static_cast<char>(ch);
+        str += 'e';
+        str += std::to_string(exp10);
+
+        const char* first = str.data();
+        const char* last = str.data() + str.size();
+
+        std::from_chars_result rs;
+        if (single)
+        {
+            float f;
+            rs = std::from_chars(first, last, f);
+            value = f;
+        }
+        else
+        {
+            rs = std::from_chars(first, last, value);
+        }
+
+        if (rs.ec == std::errc::result_out_of_range)
+        {
+            // from_chars does not tell overflow and underflow apart
+            auto magnitude = static_cast<std::int64_t>(integer.find_first_not_of(u8'0') != std::u8string_view::npos
+                ? integer.size() - integer.find_first_not_of(u8'0') : 0) + exp10;
+            if (magnitude > 0)
+                return false;
+
+            value = single ? std::strtof(str.c_str(), nullptr) : std::strtod(str.c_str(), nullptr);
+        }
+
+        return true;
+    }
+}
+
+namespace aha::front::numconv
+{
+    bool parse_integer(std::u8string_view digits, unsigned radix, std::uint64_t& value)
+    {
+        constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+
+        std::uint64_t ret = 0;
+        for (auto ch : digits)
+        {
+            auto d = static_cast<unsigned>(digit_value(ch));
+            assert(d < radix);
+
+            if (ret > (max - d) / radix)
+                return false;
+
+            ret = ret * radix + d;
+        }
+
+        value = ret;
+        return true;
+    }
+
+    bool parse_exponent(std::u8string_view str, std::int64_t& value)
+    {
+        // anything beyond this is out of range of every format anyway
+        constexpr std::int64_t saturation = 1'000'000'000;
+
+        bool negative = false;
+        if (!str.empty() && (str[0] == u8'+' || str[0] == u8'-'))
+        {
+            negative = (str[0] == u8'-');
+            str.remove_prefix(1);
+        }
+
+        if (str.empty())
+            return false;
+
+        std::int64_t ret = 0;
+        for (auto ch : str)
+        {
+            if (ch < u8'0' || u8'9' < ch)
+                return false;
+
+            if (ret < saturation)
+                ret = ret * 10 + (ch - u8'0');
+        }
+
+        value = negative ? -ret : ret;
+        return true;
+    }
+
+    bool parse_decimal_float(std::u8string_view integer, std::u8string_view fraction,
+        std::int64_t exp10, bool single, double& value)
+    {
+        const auto& fmt = single ? binary32 : binary64;
+
+        // first 19 significant digits always fit in 64 bits
+        std::uint64_t w = 0;
+        int count = 0;
+        std::int64_t q = exp10;
+        bool truncated = false;
+
+        for (auto ch : integer)
+        {
+            int d = ch - u8'0';
+            if (count == 0 && d == 0)
+                continue;
+
+            if (count < 19)
+            {
+                w = w * 10 + d;
+                ++count;
+            }
+            else
+            {
+                ++q;
+                truncated = truncated || (d != 0);
+            }
+        }
+        for (auto ch : fraction)
+        {
+            int d = ch - u8'0';
+            if (count == 0 && d == 0)
+            {
+                --q;
+                continue;
+            }
+
+            if (count < 19)
+            {
+                w = w * 10 + d;
+                ++count;
+                --q;
+            }
+            else
+            {
+                truncated = truncated || (d != 0);
+            }
+        }
+
+        if (w == 0)
+        {
+            value = 0;
+            return true;
+        }
+
+        // Clinger's fast path: both w and 10^q are exact, so one correctly rounded operation
+        if (!truncated && -fmt.max_exact_power_of_ten <= q && q <= fmt.max_exact_power_of_ten
+            && w <= (std::uint64_t(1) << (fmt.mantissa_bits + 1)))
+        {
+            if (single)
+            {
+                auto f = static_cast<float>(w);
+                auto p = static_cast<float>(exact_pow10[q < 0 ? -q : q]);
+                value = q < 0 ? f / p : f * p;
+            }
+            else
+            {
+                auto d = static_cast<double>(w);
+                value = q < 0 ? d / exact_pow10[-q] : d * exact_pow10[q];
+            }
+            return true;
+        }
+
+        adjusted_mantissa am;
+        bool decided = eisel_lemire(w, q, fmt, am);
+
+        if (decided && truncated)
+        {
+            // the exact value lies between w and w + 1
+            adjusted_mantissa am_up;
+            decided = eisel_lemire(w + 1, q, fmt, am_up)
+                && am.mantissa == am_up.mantissa && am.power2 == am_up.power2;
+        }
+
+        if (!decided)
+            return parse_decimal_fallback(integer, fraction, exp10, single, value);
+
+        if (am.power2 == fmt.infinite_power)
+            return false;
+
+        value = to_double(am, single);
+        return true;
+    }
+
+    bool parse_binary_float(std::u8string_view integer, std::u8string_view fraction,
+        unsigned radix, std::int64_t exp2, bool single, double& value)
+    {
+        const auto& fmt = single ? binary32 : binary64;
+
+        const int bits = (radix == 2) ? 1 : (radix == 8) ? 3 : 4;
+        assert(radix == 2 || radix == 8 || radix == 16);
+
+        // value = m * 2^e, with the digits that do not fit in m reduced to a sticky bit
+        std::uint64_t m = 0;
+        int n = 0;
+        std::int64_t e = exp2;
+        bool sticky = false;
+
+        auto push = [&](char8_t ch, bool is_fraction) {
+            auto d = static_cast<unsigned>(digit_value(ch));
+
+            if (n == 0 && d == 0)
+            {
+                if (is_fraction)
+                    e -= bits;
+                return;
+            }
+
+            int width = (n == 0) ? std::bit_width(d) : bits;
+            if (n + width <= 64)
+            {
+                m = (m << bits) | d;
+                n += width;
+                if (is_fraction)
+                    e -= bits;
+            }
+            else
+            {
+                if (!is_fraction)
+                    e += bits;
+                sticky = sticky || (d != 0);
+            }
+        };
+
+        for (auto ch : integer)
+            push(ch, false);
+        for (auto ch : fraction)
+            push(ch, true);
+
+        if (m == 0)
+        {
+            value = 0;
+            return true;
+        }
+
+        const int precision = fmt.mantissa_bits + 1;
+        const std::int64_t min_normal = fmt.min_exponent + 1;
+        const std::int64_t max_normal = -fmt.min_exponent;
+
+        // exponent of the most significant bit
+        std::int64_t msb = n - 1 + e;
+        if (msb > max_normal)
+            return false;
+
+        // subnormals have fewer significant bits
+        std::int64_t keep = precision - std::max<std::int64_t>(0, min_normal - msb);
+        if (keep < 0)
+        {
+            value = 0;
+            return true;
+        }
+
+        std::int64_t shift = n - keep;
+        if (shift > 0)
+        {
+            std::uint64_t kept = (shift >= 64) ? 0 : (m >> shift);
+            std::uint64_t rest = (shift >= 64) ? m : (m & ((std::uint64_t(1) << shift) - 1));
+            std::uint64_t half = std::uint64_t(1) << (shift - 1);
+
+            if (rest > half || (rest == half && (sticky || (kept & 1))))
+                ++kept;
+
+            m = kept;
+            e += shift;
+        }
+
+        // m has at most 'precision' bits here, so this is exact
+        value = std::ldexp(static_cast<double>(m), static_cast<int>(e));
+
+        if (single ? value > std::numeric_limits<float>::max() : std::isinf(value))
+            return false;
+
+        return true;
+    }
+}
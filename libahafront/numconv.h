@@ -0,0 +1,48 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+
+namespace aha::front::numconv
+{
+    // all functions take the digits of the literal without any prefix, seperator or postfix.
+
+    // returns false on overflow of 64-bit unsigned integer.
+    bool parse_integer(std::u8string_view digits, unsigned radix, std::uint64_t& value);
+
+    // parses an exponent part, which is decimal digits with an optional sign.
+    // returns false if there's no digit.
+    bool parse_exponent(std::u8string_view str, std::int64_t& value);
+
+    // value = integer.fraction * 10^exp10, correctly rounded to double (or float if 'single').
+    // returns false if the value is too large to be represented.
+    bool parse_decimal_float(std::u8string_view integer, std::u8string_view fraction,
+        std::int64_t exp10, bool single, double& value);
+
+    // value = integer.fraction * 2^exp2, where radix is 2, 8 or 16. exact rounding.
+    // returns false if the value is too large to be represented.
+    bool parse_binary_float(std::u8string_view integer, std::u8string_view fraction,
+        unsigned radix, std::int64_t exp2, bool single, double& value);
+}
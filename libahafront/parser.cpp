@@ -23,12 +23,1238 @@
 #include "pch.h"
 #include "aha/front/parser.hpp"
 
+#include <numeric>
+
+namespace
+{
+    using namespace aha::front;
+
+    template <typename T>
+    bool holds(const token* tok)
+    {
+        return tok && std::holds_alternative<T>(tok->data);
+    }
+
+    constexpr std::u8string_view type_keywords[] = {
+        u8"byte", u8"sbyte", u8"short", u8"ushort", u8"int", u8"uint", u8"long", u8"ulong",
+        u8"bool", u8"object", u8"string",
+    };
+
+    // every operator of expressions. a binding power is 0 where the operator has no such form.
+    struct operator_info
+    {
+        std::u8string_view punct;
+        std::uint8_t infix;         // binding power as a binary operator
+        bool right;                 // right-associative as a binary operator
+        std::uint8_t prefix;        // binding power as a prefix operator
+        bool postfix;
+        node_kind kind;             // node of the binary form
+    };
+
+    constexpr std::uint8_t prefix_power = 16;
+
+    constexpr operator_info operators[] = {
+        { u8"=", 1, true, 0, false, node_kind::assign },
+        { u8"+=", 1, true, 0, false, node_kind::assign },
+        { u8"-=", 1, true, 0, false, node_kind::assign },
+        { u8"*=", 1, true, 0, false, node_kind::assign },
+        { u8"/=", 1, true, 0, false, node_kind::assign },
+        { u8"%=", 1, true, 0, false, node_kind::assign },
+        { u8"&=", 1, true, 0, false, node_kind::assign },
+        { u8"|=", 1, true, 0, false, node_kind::assign },
+        { u8"^=", 1, true, 0, false, node_kind::assign },
+        { u8"<<=", 1, true, 0, false, node_kind::assign },
+        { u8">>=", 1, true, 0, false, node_kind::assign },
+        { u8":=:", 1, true, 0, false, node_kind::assign },
+        { u8"=>", 2, true, 0, false, node_kind::lambda },
+        { u8"|>", 3, false, 0, false, node_kind::binary },
+        { u8"<&", 4, true, 0, false, node_kind::binary },
+        { u8"&>", 4, false, 0, false, node_kind::binary },
+        { u8"||", 5, false, 0, false, node_kind::binary },
+        { u8"&&", 6, false, 0, false, node_kind::binary },
+        { u8"^", 8, false, 0, false, node_kind::binary },
+        { u8"&", 9, false, 0, false, node_kind::binary },
+        { u8"==", 10, false, 0, false, node_kind::binary },
+        { u8"!=", 10, false, 0, false, node_kind::binary },
+        { u8"<", 11, false, 0, false, node_kind::binary },
+        { u8">", 11, false, 0, false, node_kind::binary },
+        { u8"<=", 11, false, 0, false, node_kind::binary },
+        { u8">=", 11, false, 0, false, node_kind::binary },
+        { u8"<<", 12, false, 0, false, node_kind::binary },
+        { u8">>", 12, false, 0, false, node_kind::binary },
+        { u8"+", 13, false, prefix_power, false, node_kind::binary },
+        { u8"-", 13, false, prefix_power, false, node_kind::binary },
+        { u8"*", 14, false, 0, false, node_kind::binary },
+        { u8"/", 14, false, 0, false, node_kind::binary },
+        { u8"%", 14, false, 0, false, node_kind::binary },
+        { u8"!", 0, false, prefix_power, false, node_kind::binary },
+        { u8"~", 0, false, prefix_power, false, node_kind::binary },
+        { u8"++", 0, false, prefix_power, true, node_kind::binary },
+        { u8"--", 0, false, prefix_power, true, node_kind::binary },
+    };
+
+    constexpr std::uint16_t operator_count = std::size(operators);
+
+    // ast_node::op is the index into operators
+    std::uint16_t find_operator(const token* tok)
+    {
+        auto punct = tok ? std::get_if<token_punct>(&tok->data) : nullptr;
+        if (!punct)
+            return operator_count;
+
+        std::u8string_view str = punct->str;
+
+        std::uint16_t idx = 0;
+        while (idx < operator_count && operators[idx].punct != str)
+            ++idx;
+        return idx;
+    }
+
+    bool is_before(source_position lhs, source_position rhs)
+    {
+        return lhs.line < rhs.line || (lhs.line == rhs.line && lhs.col < rhs.col);
+    }
+
+    bool is_type_keyword(const token* tok)
+    {
+        if (auto kw = tok ? std::get_if<token_keyword>(&tok->data) : nullptr)
+            return std::find(std::begin(type_keywords), std::end(type_keywords), kw->str) != std::end(type_keywords);
+        return false;
+    }
+}
+
 namespace aha::front
 {
-    parser::parser() = default;
+    std::u8string_view operator_text(std::uint16_t op)
+    {
+        if (op >= operator_count)
+            throw std::out_of_range("operator_text: invalid operator");
+        return operators[op].punct;
+    }
+
+    parser::parser()
+        : m_tree(&m_ast), m_module_resource(nullptr), m_diagnostics(nullptr), m_lazy_bodies(false), m_token_nodes(nullptr)
+    {
+        clearAll();
+    }
+
     parser::~parser() = default;
 
+    void parser::clearAll()
+    {
+        m_tokens.clear();
+        m_token_base = 0;
+        m_pos = 0;
+        m_decl_start = 0;
+        m_line_start = true;
+        m_split_shift = false;
+        m_interpol_depth = 0;
+        m_depth = 0;
+
+        m_stack.clear();
+        m_ops.clear();
+        m_decls.clear();
+
+        m_ast = ast(m_module_resource ? m_module_resource : std::pmr::get_default_resource());
+    }
+
     void parser::parse(const token& tok)
     {
+        parse(token(tok));
+    }
+
+    void parser::parse(token&& tok)
+    {
+        bool newline = std::holds_alternative<token_newline>(tok.data);
+
+        // a line at level 0 begins the next top-level declaration
+        if (m_line_start && !newline && !std::holds_alternative<token_indent>(tok.data))
+            flushDeclaration();
+
+        m_line_start = newline;
+        m_tokens.push_back(std::move(tok));
+    }
+
+    void parser::finish()
+    {
+        flushDeclaration();
+
+        source_position beg { 0, 0 }, end { 0, 0 };
+        if (!m_decls.empty())
+        {
+            beg = (*m_tree)[m_decls.front()].beg;
+            end = (*m_tree)[m_decls.back()].end;
+        }
+
+        m_tree->setRoot(m_tree->add(node_kind::module, beg, end, m_decls));
+        m_decls.clear();
+        m_line_start = true;
+    }
+
+    const ast& parser::getModule() const
+    {
+        return m_ast;
+    }
+
+    ast parser::takeModule()
+    {
+        auto ret = std::move(m_ast);
+        m_ast = ast(m_module_resource ? m_module_resource : std::pmr::get_default_resource());
+        return ret;
+    }
+
+    void parser::setModuleResource(std::pmr::memory_resource* resource)
+    {
+        m_module_resource = resource;
+    }
+
+    void parser::setDiagnostics(diagnostics* diag)
+    {
+        m_diagnostics = diag;
+    }
+
+    void parser::setLazyBodies(bool lazy)
+    {
+        m_lazy_bodies = lazy;
+    }
+
+    void parser::flushDeclaration()
+    {
+        if (m_tokens.empty())
+            return;
+
+        parseDeclaration();
+
+        m_token_base += m_tokens.size();
+        m_tokens.clear();
+        m_pos = 0;
+        m_decl_start = 0;
+    }
+
+    void parser::parseDeclaration()
+    {
+        m_pos = 0;
+        m_decl_start = 0;
+        m_split_shift = false;
+        m_interpol_depth = 0;
+        m_depth = 0;
+
+        parseTopLevelLines(m_decls);
+    }
+
+    // a declaration with a syntax error becomes an error node up to the next line at level 0
+    void parser::parseTopLevelLines(std::vector<node_id>& items)
+    {
+        while (true)
+        {
+            skipBlankLines();
+            if (!peek())
+                break;
+
+            auto start = m_pos;
+            auto beg = peek()->beg;
+            m_decl_start = start;
+
+            try
+            {
+                if (lineLevel() != 0)
+                    fail(peek()->beg, "unexpected indentation");
+
+                items.push_back(parseTopLevel());
+            }
+            catch (syntax_error&)
+            {
+                m_stack.clear();
+                m_ops.clear();
+                m_split_shift = false;
+                m_interpol_depth = 0;
+                m_depth = 0;
+
+                if (m_pos == start)
+                    next();
+
+                while (peek() && (!holds<token_newline>(&m_tokens[m_pos - 1])
+                    || holds<token_newline>(peek()) || holds<token_indent>(peek())))
+                {
+                    next();
+                }
+
+                items.push_back(addNode(node_kind::error, beg, m_stack.size()));
+            }
+        }
+    }
+
+    bool parser::parseItems(ast& tree, std::span<const token> tokens, node_kind container, unsigned level,
+        std::vector<node_id>& items, std::span<node_id> token_nodes)
+    {
+        assert(tokens.size() == token_nodes.size());
+
+        m_tokens.assign(tokens.begin(), tokens.end());
+        m_pos = 0;
+        m_decl_start = 0;
+        m_split_shift = false;
+        m_interpol_depth = 0;
+        m_depth = 0;
+
+        std::fill(token_nodes.begin(), token_nodes.end(), null_node);
+        m_token_nodes = token_nodes.data();
+        m_unmapped.resize(tokens.size() + 1);
+        std::iota(m_unmapped.begin(), m_unmapped.end(), std::size_t(0));
+
+        // the nodes go to tree in place of the module being parsed
+        m_tree = &tree;
+
+        auto restore = [&] {
+            m_tree = &m_ast;
+            m_tokens.clear();
+            m_pos = 0;
+            m_stack.clear();
+            m_ops.clear();
+            m_token_nodes = nullptr;
+        };
+
+        bool ok = true;
+        try
+        {
+            if (container == node_kind::module)
+            {
+                parseTopLevelLines(items);
+            }
+            else
+            {
+                auto mark = items.size();
+                parseLines(level, [&] {
+                    items.push_back(container == node_kind::block ? parseStatement(level) : parseMember(level));
+                });
+
+                // a line at a lower level ends the container before the tokens do
+                skipBlankLines();
+                ok = !peek() && items.size() != mark;
+            }
+        }
+        catch (syntax_error&)
+        {
+            ok = false;
+        }
+        catch (...)
+        {
+            restore();
+            throw;
+        }
+
+        restore();
+        return ok;
+    }
+
+    const token* parser::peek(std::size_t n /* = 0 */) const
+    {
+        return (m_pos + n < m_tokens.size() ? &m_tokens[m_pos + n] : nullptr);
+    }
+
+    const token& parser::next()
+    {
+        assert(m_pos < m_tokens.size());
+        return m_tokens[m_pos++];
+    }
+
+    bool parser::atLineEnd() const
+    {
+        auto tok = peek();
+        return !tok || std::holds_alternative<token_newline>(tok->data);
+    }
+
+    bool parser::isPunct(const char8_t* str, std::size_t n /* = 0 */) const
+    {
+        auto tok = peek(n);
+        auto punct = tok ? std::get_if<token_punct>(&tok->data) : nullptr;
+        return punct && punct->str == str;
+    }
+
+    bool parser::isKeyword(const char8_t* str, std::size_t n /* = 0 */) const
+    {
+        auto tok = peek(n);
+        auto kw = tok ? std::get_if<token_keyword>(&tok->data) : nullptr;
+        return kw && kw->str == str;
+    }
+
+    bool parser::isIdentifier(std::size_t n /* = 0 */) const
+    {
+        return holds<token_identifier>(peek(n));
+    }
+
+    void parser::expectPunct(const char8_t* str, const char* msg)
+    {
+        if (!isPunct(str))
+            fail(msg);
+        next();
+    }
+
+    void parser::expectLineEnd()
+    {
+        if (!atLineEnd())
+            fail("expected end of line");
+        if (peek())
+            next();
+    }
+
+    // at the end of the declaration so far, if the next token is in a later line
+    void parser::fail(const char* msg)
+    {
+        auto end = lastEnd();
+        if (!peek())
+            fail(end, msg);
+
+        if (m_pos > m_decl_start && peek()->beg.line > end.line && !is_before(end, m_tokens[m_decl_start].beg))
+            fail(end, msg);
+
+        fail(peek()->beg, msg);
+    }
+
+    void parser::fail(source_position pos, const char* msg)
+    {
+        auto& src = *m_tokens.back().ptr_src;
+
+        if (!m_diagnostics)
+            throw parser_error(src, pos, msg);
+
+        m_diagnostics->report(src, pos, msg);
+        throw syntax_error { };
+    }
+
+    unsigned parser::lineLevel()
+    {
+        auto tok = peek();
+        if (auto indent = tok ? std::get_if<token_indent>(&tok->data) : nullptr)
+            return indent->level;
+        return 0;
+    }
+
+    void parser::skipBlankLines()
+    {
+        while (true)
+        {
+            if (holds<token_newline>(peek()))
+                next();
+            else if (holds<token_indent>(peek()) && (!peek(1) || holds<token_newline>(peek(1))))
+                next();
+            else
+                break;
+        }
+    }
+
+    // calls func for each line at the level, which must consume the line
+    template <typename Func>
+    void parser::parseLines(unsigned level, Func func)
+    {
+        while (true)
+        {
+            // blank lines after the last line are left to the outer lines
+            auto line = m_pos;
+            skipBlankLines();
+
+            if (!peek() || lineLevel() < level)
+            {
+                m_pos = line;
+                break;
+            }
+
+            auto line_level = lineLevel();
+            if (line_level > level)
+                fail(peek()->beg, "unexpected indentation");
+
+            if (line_level != 0)
+                next();
+
+            func();
+        }
+    }
+
+    std::uint8_t parser::parseModifiers()
+    {
+        std::uint8_t modifiers = 0;
+
+        while (true)
+        {
+            std::uint8_t bit;
+
+            if (isKeyword(u8"public"))
+                bit = modifier::public_;
+            else if (isKeyword(u8"private"))
+                bit = modifier::private_;
+            else if (isKeyword(u8"protected"))
+                bit = modifier::protected_;
+            else if (isKeyword(u8"internal"))
+                bit = modifier::internal;
+            else if (isKeyword(u8"static"))
+                bit = modifier::static_;
+            else if (isKeyword(u8"final"))
+                bit = modifier::final;
+            else
+                return modifiers;
+
+            if (modifiers & bit)
+                fail("duplicated modifier");
+
+            modifiers |= bit;
+            next();
+        }
+    }
+
+    node_id parser::parseTopLevel()
+    {
+        if (isKeyword(u8"import") || isKeyword(u8"module"))
+        {
+            auto kind = (isKeyword(u8"import") ? node_kind::import : node_kind::module_name);
+            next();
+
+            auto id = parseQualifiedName(kind);
+            expectLineEnd();
+            return id;
+        }
+
+        return parseMember(0);
+    }
+
+    node_id parser::parseQualifiedName(node_kind kind)
+    {
+        auto beg = m_tokens[m_pos - 1].beg;
+        auto mark = m_stack.size();
+
+        while (true)
+        {
+            if (!isIdentifier())
+                fail("expected a name");
+
+            auto& tok = next();
+            auto& str = std::get<token_identifier>(tok.data).str;
+            m_stack.push_back(addNode(node_kind::name, tok.beg, m_stack.size(), m_tree->addText(str)));
+
+            if (!isPunct(u8"."))
+                break;
+            next();
+        }
+
+        return addNode(kind, beg, mark);
+    }
+
+    node_id parser::parseMember(unsigned level)
+    {
+        auto beg = peek()->beg;
+        auto modifiers = parseModifiers();
+
+        if (isKeyword(u8"class"))
+            return parseTypeDecl(node_kind::class_decl, modifiers, beg, level);
+        if (isKeyword(u8"interface"))
+            return parseTypeDecl(node_kind::interface_decl, modifiers, beg, level);
+        if (isKeyword(u8"enum"))
+            return parseEnum(modifiers, beg, level);
+
+        if (isKeyword(u8"func"))
+        {
+            next();
+            return parseFunc(modifiers, beg, null_node, level);
+        }
+
+        if (isKeyword(u8"let") || isKeyword(u8"var"))
+        {
+            auto id = parseVariable(node_kind::field_decl, modifiers, beg);
+            expectLineEnd();
+            return id;
+        }
+
+        // C-style method, e.g. 'public static void main(args: string[]):'
+        if (isIdentifier() || is_type_keyword(peek()))
+        {
+            auto return_type = parseType();
+            return parseFunc(modifiers, beg, return_type, level);
+        }
+
+        fail("expected a declaration");
+    }
+
+    node_id parser::parseTypeDecl(node_kind kind, std::uint8_t modifiers, source_position beg, unsigned level)
+    {
+        next();
+
+        if (!isIdentifier())
+            fail("expected a name");
+        auto name = m_tree->addText(std::get<token_identifier>(next().data).str);
+
+        auto mark = m_stack.size();
+
+        if (isPunct(u8"<"))
+        {
+            next();
+            while (true)
+            {
+                if (!isIdentifier())
+                    fail("expected a type parameter");
+
+                auto& tok = next();
+                auto& str = std::get<token_identifier>(tok.data).str;
+                m_stack.push_back(addNode(node_kind::type_param, tok.beg, m_stack.size(), m_tree->addText(str)));
+
+                if (!isPunct(u8","))
+                    break;
+                next();
+            }
+            expectTypeClose();
+        }
+
+        expectPunct(u8":", "expected ':'");
+        expectLineEnd();
+
+        auto members = m_stack.size();
+        parseLines(level + 1, [&] { m_stack.push_back(parseMember(level + 1)); });
+
+        if (m_stack.size() == members)
+            fail("expected an indented block");
+
+        return addNode(kind, beg, mark, name, modifiers);
+    }
+
+    node_id parser::parseEnum(std::uint8_t modifiers, source_position beg, unsigned level)
+    {
+        next();
+
+        if (!isIdentifier())
+            fail("expected a name");
+        auto name = m_tree->addText(std::get<token_identifier>(next().data).str);
+
+        expectPunct(u8":", "expected ':'");
+        expectLineEnd();
+
+        auto mark = m_stack.size();
+
+        // one or more enumerators in a line, seperated by ','
+        parseLines(level + 1, [&] {
+            while (!atLineEnd())
+            {
+                if (!isIdentifier())
+                    fail("expected an enumerator");
+
+                auto& tok = next();
+                auto& str = std::get<token_identifier>(tok.data).str;
+                m_stack.push_back(addNode(node_kind::enumerator, tok.beg, m_stack.size(), m_tree->addText(str)));
+
+                if (!isPunct(u8","))
+                    break;
+                next();
+            }
+            expectLineEnd();
+        });
+
+        if (m_stack.size() == mark)
+            fail("expected an indented block");
+
+        return addNode(node_kind::enum_decl, beg, mark, name, modifiers);
+    }
+
+    node_id parser::parseFunc(std::uint8_t modifiers, source_position beg, node_id return_type, unsigned level)
+    {
+        if (!isIdentifier())
+            fail("expected a name");
+        auto name = m_tree->addText(std::get<token_identifier>(next().data).str);
+
+        auto mark = m_stack.size();
+
+        expectPunct(u8"(", "expected '('");
+        if (!isPunct(u8")"))
+        {
+            while (true)
+            {
+                if (!isIdentifier())
+                    fail("expected a parameter");
+
+                auto& tok = next();
+                auto param = m_tree->addText(std::get<token_identifier>(tok.data).str);
+
+                expectPunct(u8":", "expected ':'");
+
+                auto param_mark = m_stack.size();
+                m_stack.push_back(parseType());
+                m_stack.push_back(addNode(node_kind::param, tok.beg, param_mark, param));
+
+                if (!isPunct(u8","))
+                    break;
+                next();
+            }
+        }
+        expectPunct(u8")", "expected ')'");
+
+        // 'func f(): T:' has the return type after the parameters
+        bool body_follows = isPunct(u8":") && (!peek(1) || holds<token_newline>(peek(1)));
+        if (return_type == null_node && isPunct(u8":") && !body_follows)
+        {
+            next();
+            return_type = parseType();
+        }
+
+        if (return_type == null_node)
+            return_type = m_tree->add(node_kind::empty, lastEnd(), lastEnd());
+        m_stack.push_back(return_type);
+
+        if (isPunct(u8":"))
+        {
+            next();
+            expectLineEnd();
+            m_stack.push_back(m_lazy_bodies && !m_token_nodes ? skipBody(level + 1) : parseBlock(level + 1));
+        }
+        else
+        {
+            // declaration only, as in an interface
+            expectLineEnd();
+            m_stack.push_back(m_tree->add(node_kind::empty, lastEnd(), lastEnd()));
+        }
+
+        return addNode(node_kind::func_decl, beg, mark, name, modifiers);
+    }
+
+    node_id parser::parseVariable(node_kind kind, std::uint8_t modifiers, source_position beg)
+    {
+        if (isKeyword(u8"var"))
+            modifiers |= node_flag::mutable_;
+        next();
+
+        if (!isIdentifier())
+            fail("expected a name");
+        auto name = m_tree->addText(std::get<token_identifier>(next().data).str);
+
+        auto mark = m_stack.size();
+
+        if (isPunct(u8":"))
+        {
+            next();
+            m_stack.push_back(parseType());
+        }
+        else
+        {
+            m_stack.push_back(m_tree->add(node_kind::empty, lastEnd(), lastEnd()));
+        }
+
+        if (isPunct(u8"="))
+        {
+            next();
+            m_stack.push_back(parseExpression());
+        }
+        else
+        {
+            m_stack.push_back(m_tree->add(node_kind::empty, lastEnd(), lastEnd()));
+        }
+
+        return addNode(kind, beg, mark, name, modifiers);
+    }
+
+    node_id parser::parseBlock(unsigned level)
+    {
+        auto mark = m_stack.size();
+        auto start = m_pos;
+        parseLines(level, [&] { m_stack.push_back(parseStatement(level)); });
+
+        if (m_stack.size() == mark)
+            fail("expected an indented block");
+
+        auto id = addNode(node_kind::block, (*m_tree)[m_stack[mark]].beg, mark);
+
+        // the line breaks before the first statement are of the block as well
+        if (m_token_nodes)
+            mapTokens(id, m_tokens[start].beg);
+        return id;
+    }
+
+    // the lines of the block, which are checked only by parseBody()
+    node_id parser::skipBody(unsigned level)
+    {
+        auto start = m_pos;
+        source_position beg;
+        bool empty = true;
+
+        while (true)
+        {
+            auto line = m_pos;
+            skipBlankLines();
+
+            if (!peek() || lineLevel() < level)
+            {
+                m_pos = line;
+                break;
+            }
+
+            if (empty)
+            {
+                beg = peek(1)->beg;
+                empty = false;
+            }
+
+            while (!atLineEnd())
+                next();
+            if (peek())
+                next();
+        }
+
+        if (empty)
+            fail("expected an indented block");
+
+        if (m_token_base + m_pos > UINT32_MAX)
+            throw std::length_error("too many tokens in a module");
+
+        auto body = m_tree->addLazyBody({ static_cast<std::uint32_t>(m_token_base + start),
+            static_cast<std::uint32_t>(m_token_base + m_pos), level });
+        return addNode(node_kind::block, beg, m_stack.size(), body, node_flag::lazy);
+    }
+
+    void parser::parseBody(ast& tree, node_id block, std::span<const token> tokens)
+    {
+        auto body = tree.lazyBody(block);
+
+        m_tokens.assign(tokens.begin() + body.token_beg, tokens.begin() + body.token_end);
+        m_pos = 0;
+        m_decl_start = 0;
+        m_split_shift = false;
+        m_interpol_depth = 0;
+        m_depth = 0;
+
+        // the nodes go to tree in place of the module being parsed
+        m_tree = &tree;
+
+        auto restore = [&] {
+            m_tree = &m_ast;
+            m_tokens.clear();
+            m_pos = 0;
+            m_stack.clear();
+            m_ops.clear();
+        };
+
+        try
+        {
+            parseLines(body.level, [&] { m_stack.push_back(parseStatement(body.level)); });
+        }
+        catch (syntax_error&)
+        {
+            m_stack.clear();
+            m_ops.clear();
+            m_pos = m_tokens.size();
+            m_stack.push_back(addNode(node_kind::error, (*m_tree)[block].beg, m_stack.size()));
+        }
+        catch (...)
+        {
+            restore();
+            throw;
+        }
+
+        m_tree->setBody(block, m_stack);
+        restore();
+    }
+
+    node_id parser::parseStatement(unsigned level)
+    {
+        auto beg = peek()->beg;
+        auto mark = m_stack.size();
+
+        if (isKeyword(u8"let") || isKeyword(u8"var"))
+        {
+            auto id = parseVariable(node_kind::variable, 0, beg);
+            expectLineEnd();
+            return id;
+        }
+
+        m_stack.push_back(parseExpression());
+
+        // e.g. 'while x:' followed by an indented block
+        if (isPunct(u8":") && (!peek(1) || holds<token_newline>(peek(1))))
+        {
+            next();
+            expectLineEnd();
+            m_stack.push_back(parseBlock(level + 1));
+            return addNode(node_kind::block_stmt, beg, mark);
+        }
+
+        auto id = addNode(node_kind::expr_stmt, beg, mark);
+        expectLineEnd();
+        return id;
+    }
+
+    node_id parser::parseType()
+    {
+        auto beg = peek() ? peek()->beg : lastEnd();
+
+        std::u8string name;
+        if (is_type_keyword(peek()))
+        {
+            name = std::get<token_keyword>(next().data).str;
+        }
+        else
+        {
+            // possibly dotted, e.g. aha.core.List
+            while (true)
+            {
+                if (!isIdentifier())
+                    fail("expected a type");
+
+                name += std::get<token_identifier>(next().data).str;
+
+                if (!isPunct(u8".") || !isIdentifier(1))
+                    break;
+                next();
+                name += u8'.';
+            }
+        }
+
+        auto mark = m_stack.size();
+
+        if (isPunct(u8"<"))
+        {
+            next();
+
+            if (m_depth == max_nesting)
+                fail("type is nested too deeply");
+            ++m_depth;
+
+            while (true)
+            {
+                m_stack.push_back(parseType());
+                if (!isPunct(u8","))
+                    break;
+                next();
+            }
+            expectTypeClose();
+
+            --m_depth;
+        }
+
+        auto id = addNode(node_kind::type_name, beg, mark, m_tree->addText(name));
+
+        while (!m_split_shift && isPunct(u8"[") && isPunct(u8"]", 1))
+        {
+            next();
+            next();
+
+            m_stack.push_back(id);
+            id = addNode(node_kind::type_array, beg, m_stack.size() - 1);
+        }
+
+        return id;
+    }
+
+    // '>>' closes two lists of type arguments
+    void parser::expectTypeClose()
+    {
+        if (m_split_shift)
+        {
+            m_split_shift = false;
+            next();
+        }
+        else if (isPunct(u8">"))
+        {
+            next();
+        }
+        else if (isPunct(u8">>"))
+        {
+            m_split_shift = true;
+        }
+        else
+        {
+            fail("expected '>'");
+        }
+    }
+
+    // precedence climbing over an explicit stack of operators, so that the depth of recursion
+    // does not grow with precedence levels; only parentheses and brackets recurse.
+    node_id parser::parseExpression()
+    {
+        if (m_depth == max_nesting)
+            fail("expression is nested too deeply");
+        ++m_depth;
+
+        auto base = m_ops.size();
+        auto mark = m_stack.size();
+
+        // pops operators above base that bind at least as tightly as power
+        auto reduce = [&](std::uint8_t power, bool right) {
+            while (m_ops.size() > base)
+            {
+                auto& top = m_ops.back();
+                auto top_power = (top.prefix ? operators[top.op].prefix : operators[top.op].infix);
+
+                if (top_power < power || (top_power == power && right))
+                    break;
+
+                if (top.prefix)
+                {
+                    addOperator(node_kind::unary, top.beg, m_stack.size() - 1, top.op, 0);
+                }
+                else
+                {
+                    auto lhs = m_stack.size() - 2;
+                    addOperator(operators[top.op].kind, (*m_tree)[m_stack[lhs]].beg, lhs, top.op, 0);
+                }
+                m_ops.pop_back();
+            }
+        };
+
+        while (true)
+        {
+            std::uint16_t op;
+            while ((op = find_operator(peek())) != operator_count && operators[op].prefix != 0)
+            {
+                m_ops.push_back({ op, true, next().beg });
+            }
+
+            m_stack.push_back(parsePostfix(true));
+
+            op = find_operator(peek());
+            if (op == operator_count || operators[op].infix == 0)
+                break;
+
+            reduce(operators[op].infix, operators[op].right);
+            m_ops.push_back({ op, false, next().beg });
+        }
+
+        reduce(0, false);
+
+        assert(m_stack.size() == mark + 1);
+        auto id = m_stack.back();
+        m_stack.pop_back();
+
+        --m_depth;
+        return id;
+    }
+
+    // 'f x y' is a call of 'f x' with 'y', when juxtapose is true
+    node_id parser::parsePostfix(bool juxtapose)
+    {
+        auto id = parsePrimary();
+        auto beg = (*m_tree)[id].beg;
+
+        while (true)
+        {
+            auto mark = m_stack.size();
+            m_stack.push_back(id);
+
+            if (isPunct(u8"."))
+            {
+                next();
+                if (!isIdentifier())
+                    fail("expected a member name");
+
+                auto name = m_tree->addText(std::get<token_identifier>(next().data).str);
+                id = addNode(node_kind::member, beg, mark, name);
+            }
+            else if (isPunct(u8"("))
+            {
+                next();
+                if (!isPunct(u8")"))
+                {
+                    while (true)
+                    {
+                        m_stack.push_back(parseExpression());
+                        if (!isPunct(u8","))
+                            break;
+                        next();
+                    }
+                }
+                expectPunct(u8")", "expected ')'");
+
+                id = addNode(node_kind::call, beg, mark);
+            }
+            else if (isPunct(u8"["))
+            {
+                next();
+                m_stack.push_back(parseExpression());
+                expectPunct(u8"]", "expected ']'");
+
+                id = addNode(node_kind::index, beg, mark);
+            }
+            else if (isPunct(u8"?."))
+            {
+                next();
+                if (!isIdentifier())
+                    fail("expected a member name");
+
+                auto name = m_tree->addText(std::get<token_identifier>(next().data).str);
+                id = addNode(node_kind::member, beg, mark, name, node_flag::optional);
+            }
+            else if (auto op = find_operator(peek()); op != operator_count && operators[op].postfix)
+            {
+                next();
+                id = addNode(node_kind::unary, beg, mark, 0, node_flag::postfix, op);
+            }
+            else if (juxtapose && startsPrimary())
+            {
+                m_stack.push_back(parsePostfix(false));
+                id = addNode(node_kind::call, beg, mark, 0, node_flag::juxtaposed);
+            }
+            else
+            {
+                m_stack.pop_back();
+                return id;
+            }
+        }
+    }
+
+    bool parser::startsPrimary() const
+    {
+        auto tok = peek();
+        return holds<token_identifier>(tok) || holds<token_number>(tok)
+            || holds<token_normal_string>(tok) || holds<token_raw_string>(tok)
+            || holds<token_interpol_string_start>(tok)
+            || (holds<token_interpol_string_end>(tok) && m_interpol_depth == 0)
+            || isKeyword(u8"this");
+    }
+
+    node_id parser::parsePrimary()
+    {
+        auto tok = peek();
+        if (!tok)
+            fail("expected an expression");
+
+        auto beg = tok->beg;
+        auto mark = m_stack.size();
+
+        if (auto t = std::get_if<token_identifier>(&tok->data))
+        {
+            next();
+            return addNode(node_kind::name, beg, mark, m_tree->addText(t->str));
+        }
+        if (isKeyword(u8"this"))
+        {
+            next();
+            return addNode(node_kind::name, beg, mark, m_tree->addText(u8"this"));
+        }
+        if (auto t = std::get_if<token_number>(&tok->data))
+        {
+            next();
+            return addNode(node_kind::number, beg, mark, m_tree->addNumber(*t));
+        }
+        if (auto t = std::get_if<token_normal_string>(&tok->data))
+        {
+            next();
+            return addNode(node_kind::string, beg, mark, m_tree->addText(t->str));
+        }
+        if (auto t = std::get_if<token_raw_string>(&tok->data))
+        {
+            next();
+            return addNode(node_kind::string, beg, mark, m_tree->addText(t->str), node_flag::raw);
+        }
+        if (holds<token_interpol_string_start>(tok) || holds<token_interpol_string_end>(tok))
+        {
+            return parseInterpolated();
+        }
+
+        if (isPunct(u8"("))
+        {
+            next();
+            auto id = parseExpression();
+            expectPunct(u8")", "expected ')'");
+            return id;
+        }
+
+        if (isPunct(u8"["))
+        {
+            next();
+            if (!isPunct(u8"]"))
+            {
+                while (true)
+                {
+                    m_stack.push_back(parseExpression());
+                    if (!isPunct(u8","))
+                        break;
+                    next();
+                }
+            }
+            expectPunct(u8"]", "expected ']'");
+            return addNode(node_kind::array, beg, mark);
+        }
+
+        fail("expected an expression");
+    }
+
+    // `a${x}b${y}c` is lexed as start "a", x, mid "b", y, end "c"; `abc` as end "abc" only
+    node_id parser::parseInterpolated()
+    {
+        auto beg = peek()->beg;
+        auto mark = m_stack.size();
+
+        while (true)
+        {
+            auto& tok = next();
+            std::u8string_view str;
+            bool last = false;
+
+            if (auto t = std::get_if<token_interpol_string_start>(&tok.data))
+                str = t->str;
+            else if (auto t = std::get_if<token_interpol_string_mid>(&tok.data))
+                str = t->str;
+            else
+                str = std::get<token_interpol_string_end>(tok.data).str, last = true;
+
+            m_stack.push_back(addNode(node_kind::string, tok.beg, m_stack.size(), m_tree->addText(str)));
+
+            if (last)
+                break;
+
+            ++m_interpol_depth;
+            m_stack.push_back(parseExpression());
+            --m_interpol_depth;
+
+            if (!holds<token_interpol_string_mid>(peek()) && !holds<token_interpol_string_end>(peek()))
+                fail("expected the rest of interpolated string");
+        }
+
+        return addNode(node_kind::interpolated, beg, mark);
+    }
+
+    node_id parser::addNode(node_kind kind, source_position beg, std::size_t children_mark,
+        std::uint32_t value, std::uint8_t flags, std::uint16_t op)
+    {
+        std::span<const node_id> children(m_stack.data() + children_mark, m_stack.size() - children_mark);
+        auto id = m_tree->add(kind, beg, lastEnd(), children, value, flags, op);
+
+        m_stack.resize(children_mark);
+
+        if (m_token_nodes)
+            mapTokens(id, beg);
+        return id;
+    }
+
+    // replaces the operands at the top of the stack with the node of an operator
+    void parser::addOperator(node_kind kind, source_position beg, std::size_t children_mark,
+        std::uint16_t op, std::uint8_t flags)
+    {
+        auto id = addNode(kind, beg, children_mark, 0, flags, op);
+        m_stack.push_back(id);
+    }
+
+    // gives the node to the tokens from beg on that no inner node has taken. the path of m_unmapped
+    // is compressed while walking, so each token is passed over only a few times in all.
+    void parser::mapTokens(node_id id, source_position beg)
+    {
+        auto find = [&](std::size_t idx) {
+            while (m_unmapped[idx] != idx)
+            {
+                m_unmapped[idx] = m_unmapped[m_unmapped[idx]];
+                idx = m_unmapped[idx];
+            }
+            return idx;
+        };
+
+        for (auto idx = find(m_pos); idx != 0 && !is_before(m_tokens[idx - 1].beg, beg); idx = find(idx))
+        {
+            m_token_nodes[idx - 1] = id;
+            m_unmapped[idx] = idx - 1;
+        }
+    }
+
+    // the end of the last token, not counting the line breaks after it
+    source_position parser::lastEnd() const
+    {
+        auto pos = m_pos;
+        while (pos != 0 && (std::holds_alternative<token_newline>(m_tokens[pos - 1].data)
+            || std::holds_alternative<token_indent>(m_tokens[pos - 1].data)))
+        {
+            --pos;
+        }
+
+        return pos != 0 ? m_tokens[pos - 1].end : source_position { 0, 0 };
     }
 }
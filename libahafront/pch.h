@@ -23,6 +23,7 @@
 #pragma once
 
 #include <string>
+#include <algorithm>
 #include <string_view>
 #include <array>
 #include <vector>
@@ -31,6 +32,7 @@
 #include <utility>
 #include <stdexcept>
 #include <cstdint>
+#include <limits>
 #include <cassert>
 
 #include <unicode/uchar.h>
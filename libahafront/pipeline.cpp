@@ -0,0 +1,223 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/pipeline.hpp"
+
+#include <thread>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+
+#include "aha/front/trace.hpp"
+
+#include "spsc_ring.h"
+
+namespace
+{
+    using namespace aha::front;
+
+    // a part is not split smaller than this, so that a task is worth scheduling
+    constexpr std::size_t min_part_tokens = 4096;
+    // parts per worker, to even out declarations of different sizes
+    constexpr std::size_t parts_per_worker = 4;
+
+    struct module_part
+    {
+        std::size_t beg, end;
+
+        // declarations of the part are parsed into the arena, and freed when appended
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+        ast tree;
+        diagnostics diag;
+        std::exception_ptr error;
+    };
+
+    // where parts begin; the same boundaries as parser::parse(), which flushes a declaration there
+    std::vector<std::size_t> split_module(std::span<const token> tokens, std::size_t part_size)
+    {
+        std::vector<std::size_t> starts { 0 };
+        bool line_start = true;
+
+        for (std::size_t idx = 0; idx < tokens.size(); ++idx)
+        {
+            auto& data = tokens[idx].data;
+            bool newline = std::holds_alternative<token_newline>(data);
+
+            if (line_start && !newline && !std::holds_alternative<token_indent>(data) && idx - starts.back() >= part_size)
+                starts.push_back(idx);
+
+            line_start = newline;
+        }
+
+        return starts;
+    }
+}
+
+namespace aha::front
+{
+    std::size_t parse_pipelined(source& src, lexer& ll, parser& yy, std::size_t queue_capacity)
+    {
+        spsc_ring<token> ring(queue_capacity);
+        std::exception_ptr lexer_ex;
+        std::size_t count = 0;
+
+        std::thread producer([&] {
+            try
+            {
+                while (auto tok = ll.lex(src))
+                {
+                    if (!ring.push(std::move(*tok)))
+                        break;
+                }
+            }
+            catch (...)
+            {
+                lexer_ex = std::current_exception();
+            }
+            ring.close();
+        });
+
+        try
+        {
+            token tok;
+            while (ring.pop(tok))
+            {
+                yy.parse(std::move(tok));
+                ++count;
+            }
+        }
+        catch (...)
+        {
+            ring.cancel();
+            producer.join();
+            throw;
+        }
+
+        producer.join();
+
+        // the tokens stop at a lexer error, so the module is not finished then
+        if (lexer_ex)
+            std::rethrow_exception(lexer_ex);
+
+        yy.finish();
+        return count;
+    }
+
+    ast parse_parallel(std::span<const token> tokens, thread_pool& pool, diagnostics* diag, std::pmr::memory_resource* resource)
+    {
+        auto part_size = std::max(tokens.size() / (pool.size() * parts_per_worker), min_part_tokens);
+        auto starts = split_module(tokens, part_size);
+
+        // nothing to merge
+        if (starts.size() == 1 || pool.size() == 1)
+        {
+            parser yy;
+            yy.setModuleResource(resource);
+            yy.clearAll();
+            yy.setDiagnostics(diag);
+
+            for (auto& tok : tokens)
+                yy.parse(tok);
+            yy.finish();
+
+            return yy.takeModule();
+        }
+
+        std::vector<module_part> parts(starts.size());
+        for (std::size_t idx = 0; idx < parts.size(); ++idx)
+        {
+            parts[idx].beg = starts[idx];
+            parts[idx].end = (idx + 1 < starts.size() ? starts[idx + 1] : tokens.size());
+        }
+
+        // parsers are reused by the tasks of the same worker
+        std::vector<parser> parsers(pool.size());
+
+        for (auto& part : parts)
+        {
+            pool.submit([&](unsigned worker) {
+                trace_span span("parse part", [&] { return std::to_string(part.beg) + "-" + std::to_string(part.end); });
+
+                auto& yy = parsers[worker];
+
+                // a token of the part takes a few nodes at most
+                part.arena = std::make_unique<std::pmr::monotonic_buffer_resource>((part.end - part.beg) * sizeof(ast_node) * 2);
+                yy.setModuleResource(part.arena.get());
+                yy.clearAll();
+                yy.setDiagnostics(diag ? &part.diag : nullptr);
+
+                try
+                {
+                    for (auto idx = part.beg; idx < part.end; ++idx)
+                        yy.parse(tokens[idx]);
+                    yy.finish();
+                    part.tree = yy.takeModule();
+                }
+                catch (...)
+                {
+                    part.error = std::current_exception();
+                }
+
+                yy.setModuleResource(nullptr);
+                yy.clearAll();
+            });
+        }
+
+        pool.wait();
+
+        trace_span span("merge parts");
+
+        ast ret(resource ? resource : std::pmr::get_default_resource());
+        std::vector<node_id> decls;
+
+        for (auto& part : parts)
+        {
+            // the parser would have stopped at the first error
+            if (part.error)
+                std::rethrow_exception(part.error);
+
+            auto offset = ret.append(part.tree);
+            for (auto id : part.tree.children(part.tree.root()))
+                decls.push_back(id + offset);
+
+            if (diag)
+            {
+                for (auto& d : part.diag.get())
+                    diag->report(*d.ptr_src, d.pos, d.message);
+            }
+
+            part.tree = ast();
+            part.arena.reset();
+        }
+
+        source_position beg { 0, 0 }, end { 0, 0 };
+        if (!decls.empty())
+        {
+            beg = ret[decls.front()].beg;
+            end = ret[decls.back()].end;
+        }
+
+        ret.setRoot(ret.add(node_kind::module, beg, end, decls));
+        return ret;
+    }
+}
@@ -0,0 +1,67 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/push_lexer.hpp"
+
+namespace aha::front
+{
+    push_lexer::push_lexer(sink_type sink, std::string name, std::pmr::memory_resource* resource)
+        : m_src(std::move(name), resource), m_lexer(resource), m_sink(std::move(sink))
+    {
+    }
+
+    push_lexer::~push_lexer() = default;
+
+    source& push_lexer::getSource()
+    {
+        return m_src;
+    }
+
+    lexer& push_lexer::getLexer()
+    {
+        return m_lexer;
+    }
+
+    void push_lexer::feed(std::string_view chunk)
+    {
+        m_src.feedString(chunk);
+        drain();
+    }
+
+    void push_lexer::feedEof()
+    {
+        m_src.feedEof();
+        drain();
+    }
+
+    bool push_lexer::isEof() const
+    {
+        return m_lexer.getLastResult() == lex_result::eof;
+    }
+
+    void push_lexer::drain()
+    {
+        while (auto tok = m_lexer.lex(m_src))
+            m_sink(std::move(*tok));
+    }
+}
@@ -0,0 +1,176 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AHA_SCAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// bulk scanners for the fast paths of the lexer.
+// every function returns the first position in [p, end) which does NOT belong to the run.
+
+namespace scan
+{
+    namespace detail
+    {
+        inline bool in_range(unsigned char ch, char lo, char hi)
+        {
+            return static_cast<unsigned char>(lo) <= ch && ch <= static_cast<unsigned char>(hi);
+        }
+
+        inline bool is_digit(unsigned char ch, unsigned radix)
+        {
+            switch (radix)
+            {
+                case 2: return in_range(ch, '0', '1');
+                case 8: return in_range(ch, '0', '7');
+                case 10: return in_range(ch, '0', '9');
+                default: return in_range(ch, '0', '9') || in_range(ch | 0x20, 'a', 'f');
+            }
+        }
+
+#ifdef AHA_SCAN_SSE2
+        // lo <= v <= hi as signed bytes; lo and hi must be ASCII, so non-ASCII bytes never match
+        inline __m128i in_range(__m128i v, char lo, char hi)
+        {
+            return _mm_and_si128(
+                _mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(hi + 1))));
+        }
+
+        // skips 16-byte blocks in which every byte matches
+        template <typename Match>
+        inline const char* run_blocks(const char* p, const char* end, Match match)
+        {
+            while (end - p >= 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+                if (int mask = _mm_movemask_epi8(match(v)) ^ 0xffff)
+                    return p + std::countr_zero(static_cast<unsigned>(mask));
+
+                p += 16;
+            }
+            return p;
+        }
+#endif
+    }
+
+    // run of printable ASCII characters other than a, b and c.
+    // stops at control characters (which include every newline and tab) and non-ASCII bytes.
+    inline const char* until_special(const char* p, const char* end, char a, char b, char c)
+    {
+#ifdef AHA_SCAN_SSE2
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        const __m128i vc = _mm_set1_epi8(c);
+        // signed compare: bytes >= 0x80 are negative, so this catches them together with controls
+        const __m128i vctl = _mm_set1_epi8(0x20);
+
+        while (end - p >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                _mm_or_si128(_mm_cmpeq_epi8(v, vc), _mm_cmplt_epi8(v, vctl)));
+
+            if (int mask = _mm_movemask_epi8(m))
+                return p + std::countr_zero(static_cast<unsigned>(mask));
+
+            p += 16;
+        }
+#endif
+        for (; p != end; ++p)
+        {
+            char ch = *p;
+            if (ch == a || ch == b || ch == c || static_cast<unsigned char>(ch) < 0x20 || static_cast<unsigned char>(ch) >= 0x80)
+                break;
+        }
+        return p;
+    }
+
+    // run of ASCII identifier characters: [A-Za-z0-9_]
+    inline const char* identifier_run(const char* p, const char* end)
+    {
+#ifdef AHA_SCAN_SSE2
+        p = detail::run_blocks(p, end, [](__m128i v) {
+            __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+            return _mm_or_si128(
+                _mm_or_si128(detail::in_range(lower, 'a', 'z'), detail::in_range(v, '0', '9')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+        });
+#endif
+        for (; p != end; ++p)
+        {
+            auto ch = static_cast<unsigned char>(*p);
+            if (!detail::in_range(ch | 0x20, 'a', 'z') && !detail::in_range(ch, '0', '9') && ch != '_')
+                break;
+        }
+        return p;
+    }
+
+    // run of ASCII blanks: space and tab
+    inline const char* blank_run(const char* p, const char* end)
+    {
+#ifdef AHA_SCAN_SSE2
+        p = detail::run_blocks(p, end, [](__m128i v) {
+            return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+        });
+#endif
+        while (p != end && (*p == ' ' || *p == '\t'))
+            ++p;
+        return p;
+    }
+
+    // run of digits of radix 2, 8, 10 or 16
+    inline const char* digit_run(const char* p, const char* end, unsigned radix)
+    {
+#ifdef AHA_SCAN_SSE2
+        switch (radix)
+        {
+            case 2:
+                p = detail::run_blocks(p, end, [](__m128i v) { return detail::in_range(v, '0', '1'); });
+                break;
+            case 8:
+                p = detail::run_blocks(p, end, [](__m128i v) { return detail::in_range(v, '0', '7'); });
+                break;
+            case 10:
+                p = detail::run_blocks(p, end, [](__m128i v) { return detail::in_range(v, '0', '9'); });
+                break;
+            default:
+                p = detail::run_blocks(p, end, [](__m128i v) {
+                    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+                    return _mm_or_si128(detail::in_range(v, '0', '9'), detail::in_range(lower, 'a', 'f'));
+                });
+                break;
+        }
+#endif
+        while (p != end && detail::is_digit(static_cast<unsigned char>(*p), radix))
+            ++p;
+        return p;
+    }
+}
@@ -24,13 +24,16 @@
 #include "aha/front/source.hpp"
 
 #include "is_newline.h"
+#include "stats.h"
+
+#include <chrono>
 
 namespace aha::front
 {
     source::~source() = default;
 
-    repl_source::repl_source(std::string name /* = "<repl>" */)
-        : m_name(std::move(name))
+    repl_source::repl_source(std::string name /* = "<repl>" */, std::pmr::memory_resource* resource)
+        : m_name(std::move(name)), m_chars(resource), m_lines(resource), m_input(resource), m_input_pos(0), m_stats(nullptr)
     {
         init();
     }
@@ -51,6 +54,7 @@ namespace aha::front
     void repl_source::clearBuffer()
     {
         m_input.clear();
+        m_input_pos = 0;
 
         m_error = false;
     }
@@ -65,10 +69,17 @@ namespace aha::front
     {
         if (m_error)
             throw std::logic_error("source has an error");
-        if (m_input_end && m_input.empty())
+        if (m_input_end && m_input_pos == m_input.size())
             throw std::logic_error("repl_source was already fed EOF");
 
-        m_input.insert(m_input.end(), line.begin(), line.end());
+        // drop the consumed input once it is the larger part of the buffer
+        if (m_input_pos * 2 >= m_input.size())
+        {
+            m_input.erase(0, m_input_pos);
+            m_input_pos = 0;
+        }
+
+        m_input += line;
     }
 
     void repl_source::feedEof()
@@ -81,109 +92,144 @@ namespace aha::front
         m_input_end = true;
     }
 
+    void repl_source::setStats(front_stats* stats)
+    {
+        m_stats = stats;
+    }
+
     std::string_view repl_source::getName()
     {
         return m_name;
     }
 
     std::optional<std::pair<char32_t, source_position>> repl_source::readChar()
+    {
+#if AHA_FRONT_STATS
+        if (m_stats && m_stats->reads++ % sample_interval == 0)
+        {
+            auto beg = sample_start();
+            auto ret = decodeChar();
+            m_stats->decode_time += time_since(beg);
+            ++m_stats->timed_reads;
+            return ret;
+        }
+#endif
+        return decodeChar();
+    }
+
+    std::optional<std::pair<char32_t, source_position>> repl_source::decodeChar()
     {
         if (m_error)
             throw std::logic_error("source has an error");
 
-        char32_t ret;
+        while (true)
+        {
+            if (m_input_pos == m_input.size())
+                return { };
+
+            auto b0 = static_cast<unsigned char>(m_input[m_input_pos]);
 
-        unsigned char b[4];
-        int count = 0;
-        if (!popByte(b[0]))
-            return { };
+            char32_t ret;
+            std::size_t length;
 
-        auto revert = [this, &b, &count]() {
-            for (int i = count - 1; i >= 0; --i)
+            if ((b0 & 0x80) == 0)
+            {
+                ret = b0;
+                length = 1;
+            }
+            else if ((b0 & 0xe0) == 0xc0)
+            {
+                ret = b0 & 0x1f;
+                length = 2;
+            }
+            else if ((b0 & 0xf0) == 0xe0)
+            {
+                ret = b0 & 0x0f;
+                length = 3;
+            }
+            else if ((b0 & 0xf8) == 0xf0)
             {
-                m_input.push_front(b[i]);
+                ret = b0 & 0x07;
+                length = 4;
             }
-        };
-        auto popFollowing = [this, &b, &count, &revert](unsigned n) {
-            count = 0;
-            for (; n > 0; --n)
+            else
             {
-                if (popByte(b[count]))
+                m_error = true;
+                AHA_FRONT_COUNT(m_stats, errors++);
+                throw invalid_byteseq(*this, getEndpoint());
+            }
+
+            auto available = std::min(length, m_input.size() - m_input_pos);
+            for (std::size_t i = 1; i < available; ++i)
+            {
+                auto b = static_cast<unsigned char>(m_input[m_input_pos + i]);
+                if ((b & 0xc0) != 0x80)
                 {
-                    if ((b[count++] & 0xc0) != 0x80)
-                    {
-                        revert();
-                        m_error = true;
-                        throw invalid_byteseq(*this, getEndpoint());
-                    }
+                    m_error = true;
+                    AHA_FRONT_COUNT(m_stats, errors++);
+                    throw invalid_byteseq(*this, getEndpoint());
                 }
-                else
+
+                ret = (ret << 6) | (b & 0x3f);
+            }
+
+            if (available < length)
+            {
+                if (m_input_end)
                 {
-                    revert();
-                    return false;
+                    m_error = true;
+                    AHA_FRONT_COUNT(m_stats, errors++);
+                    throw invalid_byteseq(*this, getEndpoint());
                 }
-            }
-            return true;
-        };
 
-        if ((b[0] & 0x80) == 0)
-        {
-            ret = static_cast<char32_t>(b[0]);
-        }
-        else if ((b[0] & 0xe0) == 0xc0)
-        {
-            if (!popFollowing(1))
+                // wait for the rest of the sequence
                 return { };
-            ret = static_cast<char32_t>(((b[0] & 0x1f) << 6) | (b[1] & 0x3f));
-        }
-        else if ((b[0] & 0xf0) == 0xe0)
-        {
-            if (!popFollowing(2))
-                return { };
-            ret = static_cast<char32_t>(((b[0] & 0x0f) << 12) | ((b[1] & 0x3f) << 6) | (b[2] & 0x3f));
-        }
-        else if ((b[0] & 0xf8) == 0xf0)
-        {
-            if (!popFollowing(3))
-                return { };
-            ret = static_cast<char32_t>(((b[0] & 0x07) << 18) | ((b[1] & 0x3f) << 12) | ((b[2] & 0x3f) << 6) | (b[3] & 0x3f));
-        }
-        else
-        {
-            revert();
-            m_error = true;
-            throw invalid_byteseq(*this, getEndpoint());
-        }
+            }
 
-        if (m_prev_is_CR)
-        {
-            m_prev_is_CR = false;
-            if (ret == U'\n')
+            // overlong encodings, surrogates and code points beyond U+10FFFF are not UTF-8
+            static constexpr char32_t min_code_point[] = { 0, 0, 0x80, 0x800, 0x10000 };
+            if (ret < min_code_point[length] || (ret >= 0xd800 && ret <= 0xdfff) || ret > 0x10ffff)
             {
-                // ignore and get next
-                return readChar();
+                m_error = true;
+                AHA_FRONT_COUNT(m_stats, errors++);
+                throw invalid_byteseq(*this, getEndpoint());
             }
-        }
 
-        if (is_newline(ret))
-        {
-            if (ret == U'\r')
-                m_prev_is_CR = true;
+            m_input_pos += length;
 
-            auto pos = getEndpoint();
+            AHA_FRONT_COUNT(m_stats, bytes_decoded += length);
+            AHA_FRONT_COUNT(m_stats, code_points++);
 
-            m_chars.push_back(U'\n');
-            m_lines.push_back(m_chars.size());
+            if (m_prev_is_CR)
+            {
+                m_prev_is_CR = false;
+                if (ret == U'\n')
+                {
+                    // ignore and get next
+                    continue;
+                }
+            }
 
-            return std::make_pair(U'\n', pos);
-        }
-        else
-        {
-            auto pos = getEndpoint();
+            if (is_newline(ret))
+            {
+                if (ret == U'\r')
+                    m_prev_is_CR = true;
+
+                auto pos = getEndpoint();
+
+                m_chars.push_back(U'\n');
+                m_lines.push_back(m_chars.size());
+
+                return std::make_pair(U'\n', pos);
+            }
+            else
+            {
+                auto pos = getEndpoint();
 
-            m_chars.push_back(ret);
+                m_chars.push_back(ret);
 
-            return std::make_pair(ret, pos);
+                return std::make_pair(ret, pos);
+            }
         }
     }
 
@@ -192,7 +238,7 @@ namespace aha::front
         if (m_error)
             return source_state::error;
 
-        if (!m_input.empty())
+        if (m_input_pos != m_input.size())
             return source_state::some;
 
         if (m_input_end)
@@ -212,17 +258,6 @@ namespace aha::front
         return m_chars[m_lines[pos.line] + pos.col];
     }
 
-    bool repl_source::popByte(unsigned char& ch)
-    {
-        if (m_input.empty())
-            return false;
-
-        ch = static_cast<unsigned char>(m_input.front());
-        m_input.pop_front();
-
-        return true;
-    }
-
     unsigned repl_source::getLineSize(unsigned line) const
     {
         unsigned lineEnd;
@@ -240,6 +275,47 @@ namespace aha::front
         return { m_lines.size() - 1, m_chars.size() - m_lines.back() };
     }
 
+    std::string_view repl_source::peekBytes() const
+    {
+        if (m_error)
+            return { };
+
+        return std::string_view { m_input }.substr(m_input_pos);
+    }
+
+    void repl_source::skipBytes(std::size_t count)
+    {
+        assert(count <= m_input.size() - m_input_pos);
+
+        if (count == 0)
+            return;
+
+#if AHA_FRONT_STATS
+        if (m_stats && m_stats->reads++ % sample_interval == 0)
+        {
+            auto beg = sample_start();
+            copyBytes(count);
+            m_stats->decode_time += time_since(beg);
+            ++m_stats->timed_reads;
+            return;
+        }
+#endif
+        copyBytes(count);
+    }
+
+    void repl_source::copyBytes(std::size_t count)
+    {
+        // the skipped bytes never contain a newline
+        m_prev_is_CR = false;
+
+        auto beg = m_input.begin() + m_input_pos;
+        m_chars.insert(m_chars.end(), beg, beg + count);
+        m_input_pos += count;
+
+        AHA_FRONT_COUNT(m_stats, bytes_decoded += count);
+        AHA_FRONT_COUNT(m_stats, code_points += count);
+    }
+
     source_position source_position::next(source& src) const
     {
         if (col + 1 < src.getLineSize(line))
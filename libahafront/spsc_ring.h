@@ -0,0 +1,163 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// bounded single-producer/single-consumer queue.
+// both sides publish their position only once per batch (or before blocking), so that
+// the shared cache lines are touched rarely. a full queue blocks the producer.
+
+template <typename T>
+class spsc_ring
+{
+public:
+    static constexpr std::size_t cache_line = 64;
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator =(const spsc_ring&) = delete;
+
+    // capacity is rounded up to a power of two
+    explicit spsc_ring(std::size_t capacity, std::size_t batch = 64)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+
+        m_slots.resize(size);
+        m_mask = size - 1;
+        m_batch = (batch < size / 2) ? batch : size / 2;
+    }
+
+    // producer side. returns false if the consumer has cancelled.
+    bool push(T&& item)
+    {
+        if (m_prod_tail - m_prod_head_cache == m_slots.size())
+        {
+            // seemingly full; publish what we have and wait for the consumer
+            publish(0);
+
+            while (true)
+            {
+                auto head = m_head.load(std::memory_order_acquire);
+                if (head & end_flag)
+                    return false;
+
+                m_prod_head_cache = head;
+                if (m_prod_tail - m_prod_head_cache != m_slots.size())
+                    break;
+
+                m_head.wait(head, std::memory_order_acquire);
+            }
+        }
+
+        m_slots[m_prod_tail & m_mask] = std::move(item);
+        ++m_prod_tail;
+
+        if (m_prod_tail - m_prod_published >= m_batch)
+            publish(0);
+
+        return true;
+    }
+
+    // producer side. no more items will be pushed.
+    void close()
+    {
+        publish(end_flag);
+    }
+
+    // consumer side. blocks until an item is available; returns false at the end of the queue.
+    bool pop(T& item)
+    {
+        if (m_cons_head == m_cons_tail_cache)
+        {
+            // seemingly empty; give the freed slots back and wait for the producer
+            release(0);
+
+            while (true)
+            {
+                auto tail = m_tail.load(std::memory_order_acquire);
+
+                m_cons_tail_cache = tail & ~end_flag;
+                if (m_cons_head != m_cons_tail_cache)
+                    break;
+                if (tail & end_flag)
+                    return false;
+
+                m_tail.wait(tail, std::memory_order_acquire);
+            }
+        }
+
+        item = std::move(m_slots[m_cons_head & m_mask]);
+        ++m_cons_head;
+
+        if (m_cons_head - m_cons_released >= m_batch)
+            release(0);
+
+        return true;
+    }
+
+    // consumer side. the producer fails at its next blocking push().
+    void cancel()
+    {
+        release(end_flag);
+    }
+
+private:
+    // positions never reach the top bit, so it marks the end of either side
+    static constexpr std::size_t end_flag = ~(~std::size_t(0) >> 1);
+
+    void publish(std::size_t flag)
+    {
+        m_prod_published = m_prod_tail;
+        m_tail.store(m_prod_tail | flag, std::memory_order_release);
+        m_tail.notify_one();
+    }
+
+    void release(std::size_t flag)
+    {
+        m_cons_released = m_cons_head;
+        m_head.store(m_cons_head | flag, std::memory_order_release);
+        m_head.notify_one();
+    }
+
+    std::vector<T> m_slots;
+    std::size_t m_mask;
+    std::size_t m_batch;
+
+    alignas(cache_line) std::atomic<std::size_t> m_head { 0 };
+    alignas(cache_line) std::atomic<std::size_t> m_tail { 0 };
+
+    // owned by producer
+    alignas(cache_line) std::size_t m_prod_tail = 0;
+    std::size_t m_prod_published = 0;
+    std::size_t m_prod_head_cache = 0;
+
+    // owned by consumer
+    alignas(cache_line) std::size_t m_cons_head = 0;
+    std::size_t m_cons_released = 0;
+    std::size_t m_cons_tail_cache = 0;
+};
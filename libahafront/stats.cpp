@@ -0,0 +1,197 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "stats.h"
+
+#include <ostream>
+
+namespace
+{
+    using namespace aha::front;
+
+    constexpr const char* token_kind_names[] = {
+        "indent", "newline", "punct", "keyword", "contextual_keyword", "identifier",
+        "normal_string", "raw_string", "interpol_string_start", "interpol_string_mid", "interpol_string_end",
+        "number", "error",
+    };
+    static_assert(std::size(token_kind_names) == front_stats::token_kinds);
+
+    double to_ms(std::chrono::nanoseconds ns)
+    {
+        return ns.count() / 1e6;
+    }
+
+    double per(std::uint64_t count, std::uint64_t total)
+    {
+        return total ? static_cast<double>(count) / total : 0;
+    }
+
+    // the time of all calls, from the time of the timed ones
+    std::chrono::nanoseconds estimate(std::chrono::nanoseconds timed, std::uint64_t calls, std::uint64_t timed_calls)
+    {
+        return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(timed.count() * per(calls, timed_calls)));
+    }
+}
+
+namespace aha::front
+{
+    // the least time between two calls of steady_clock::now()
+    std::chrono::nanoseconds timer_overhead()
+    {
+        static const auto overhead = [] {
+            auto least = std::chrono::steady_clock::duration::max();
+            for (int i = 0; i < 1000; ++i)
+            {
+                auto beg = std::chrono::steady_clock::now();
+                least = std::min(least, std::chrono::steady_clock::now() - beg);
+            }
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(least);
+        }();
+
+        return overhead;
+    }
+
+    std::chrono::steady_clock::time_point sample_start()
+    {
+        // the overhead is measured once, before the first timed call rather than in it
+        timer_overhead();
+        return std::chrono::steady_clock::now();
+    }
+
+    std::chrono::nanoseconds time_since(std::chrono::steady_clock::time_point beg)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - beg - timer_overhead();
+        return std::max<std::chrono::nanoseconds>(elapsed, std::chrono::nanoseconds::zero());
+    }
+
+    bool front_stats::enabled()
+    {
+        return AHA_FRONT_STATS;
+    }
+
+    const char* front_stats::tokenKindName(std::size_t kind)
+    {
+        return token_kind_names[kind];
+    }
+
+    void front_stats::merge(const front_stats& other)
+    {
+        bytes_decoded += other.bytes_decoded;
+        code_points += other.code_points;
+        rebuffered_chars += other.rebuffered_chars;
+        errors += other.errors;
+        peak_token_buffer = std::max(peak_token_buffer, other.peak_token_buffer);
+
+        for (std::size_t i = 0; i < token_kinds; ++i)
+            tokens[i] += other.tokens[i];
+
+        if (indent_levels.size() < other.indent_levels.size())
+            indent_levels.resize(other.indent_levels.size());
+        for (std::size_t i = 0; i < other.indent_levels.size(); ++i)
+            indent_levels[i] += other.indent_levels[i];
+
+        decode_time += other.decode_time;
+        lex_time += other.lex_time;
+        reads += other.reads;
+        timed_reads += other.timed_reads;
+        lex_calls += other.lex_calls;
+        timed_lex_calls += other.timed_lex_calls;
+
+        allocations += other.allocations;
+        allocated_bytes += other.allocated_bytes;
+    }
+
+    std::uint64_t front_stats::totalTokens() const
+    {
+        std::uint64_t total = 0;
+        for (auto count : tokens)
+            total += count;
+        return total;
+    }
+
+    std::chrono::nanoseconds front_stats::decodeTime() const
+    {
+        return estimate(decode_time, reads, timed_reads);
+    }
+
+    std::chrono::nanoseconds front_stats::lexTime() const
+    {
+        return std::max(estimate(lex_time, lex_calls, timed_lex_calls) - decodeTime(), std::chrono::nanoseconds::zero());
+    }
+
+    void front_stats::print(std::ostream& os) const
+    {
+        os << "bytes decoded:       " << bytes_decoded << "\n"
+            << "code points:         " << code_points << "\n"
+            << "rebuffered chars:    " << rebuffered_chars << "\n"
+            << "errors:              " << errors << "\n"
+            << "peak token buffer:   " << peak_token_buffer << " bytes\n"
+            << "decoding time:       " << to_ms(decodeTime()) << " ms (estimated from " << timed_reads << " of "
+                << reads << " reads)\n"
+            << "lexing time:         " << to_ms(lexTime()) << " ms (estimated from " << timed_lex_calls << " of "
+                << lex_calls << " calls, without decoding)\n"
+            << "allocations:         " << allocations << " (" << per(allocations, totalTokens()) << " per token, "
+                << per(allocations, bytes_decoded) << " per byte)\n"
+            << "allocated bytes:     " << allocated_bytes << "\n"
+            << "tokens:\n";
+
+        for (std::size_t i = 0; i < token_kinds; ++i)
+        {
+            if (tokens[i] != 0)
+                os << "  " << token_kind_names[i] << ": " << tokens[i] << "\n";
+        }
+
+        os << "indent levels:\n";
+        for (std::size_t i = 0; i < indent_levels.size(); ++i)
+        {
+            if (indent_levels[i] != 0)
+                os << "  " << i << ": " << indent_levels[i] << "\n";
+        }
+    }
+
+    void front_stats::printJson(std::ostream& os) const
+    {
+        os << "{ \"bytes_decoded\": " << bytes_decoded
+            << ", \"code_points\": " << code_points
+            << ", \"rebuffered_chars\": " << rebuffered_chars
+            << ", \"errors\": " << errors
+            << ", \"peak_token_buffer\": " << peak_token_buffer
+            << ", \"decode_ns\": " << decodeTime().count()
+            << ", \"lex_ns\": " << lexTime().count()
+            << ", \"allocations\": " << allocations
+            << ", \"allocated_bytes\": " << allocated_bytes
+            << ", \"allocations_per_token\": " << per(allocations, totalTokens())
+            << ", \"allocations_per_byte\": " << per(allocations, bytes_decoded)
+            << ", \"tokens\": {";
+
+        for (std::size_t i = 0; i < token_kinds; ++i)
+            os << (i ? ", \"" : " \"") << token_kind_names[i] << "\": " << tokens[i];
+
+        os << " }, \"indent_levels\": [";
+
+        for (std::size_t i = 0; i < indent_levels.size(); ++i)
+            os << (i ? ", " : " ") << indent_levels[i];
+
+        os << " ] }\n";
+    }
+}
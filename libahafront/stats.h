@@ -0,0 +1,48 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "aha/front/stats.hpp"
+
+#include <chrono>
+
+#ifndef AHA_FRONT_STATS
+#define AHA_FRONT_STATS 1
+#endif
+
+// AHA_FRONT_COUNT(m_stats, errors++) updates the counter if a stats object is set
+#if AHA_FRONT_STATS
+#define AHA_FRONT_COUNT(stats, expr) do { if (stats) (stats)->expr; } while (false)
+#else
+#define AHA_FRONT_COUNT(stats, expr) do { } while (false)
+#endif
+
+namespace aha::front
+{
+    // one call in sample_interval is timed for front_stats
+    constexpr std::uint64_t sample_interval = 64;
+
+    // the beginning of a timed call, and the time since then less the time steady_clock::now() itself takes
+    std::chrono::steady_clock::time_point sample_start();
+    std::chrono::nanoseconds time_since(std::chrono::steady_clock::time_point beg);
+}
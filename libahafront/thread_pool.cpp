@@ -0,0 +1,173 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/thread_pool.hpp"
+
+namespace
+{
+    // the pool and the worker index of the current thread
+    thread_local const aha::front::thread_pool* t_pool = nullptr;
+    thread_local unsigned t_worker = 0;
+}
+
+namespace aha::front
+{
+    thread_pool::thread_pool(unsigned threads)
+        : m_queued(0), m_unfinished(0), m_stop(false), m_next_queue(0)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        for (unsigned i = 0; i < threads; ++i)
+            m_queues.push_back(std::make_unique<worker_queue>());
+
+        for (unsigned i = 0; i < threads; ++i)
+            m_threads.emplace_back([this, i] { run(i); });
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv_work.notify_all();
+
+        for (auto& th : m_threads)
+            th.join();
+    }
+
+    unsigned thread_pool::size() const
+    {
+        return static_cast<unsigned>(m_threads.size());
+    }
+
+    void thread_pool::submit(task_type task)
+    {
+        unsigned target;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_unfinished;
+
+            if (t_pool == this)
+                target = t_worker;
+            else
+                target = m_next_queue++ % size();
+        }
+
+        {
+            auto& queue = *m_queues[target];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_queued;
+        }
+        m_cv_work.notify_one();
+    }
+
+    void thread_pool::wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv_idle.wait(lock, [this] { return m_unfinished == 0; });
+
+        if (m_error)
+            std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+
+    bool thread_pool::tryTake(unsigned worker, task_type& task)
+    {
+        // newest of our own, for locality
+        {
+            auto& queue = *m_queues[worker];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                return true;
+            }
+        }
+
+        // oldest of another worker, which is likely the largest piece of work left there
+        for (unsigned i = 1; i < size(); ++i)
+        {
+            auto& queue = *m_queues[(worker + i) % size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void thread_pool::run(unsigned worker)
+    {
+        t_pool = this;
+        t_worker = worker;
+
+        while (true)
+        {
+            task_type task;
+
+            if (tryTake(worker, task))
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    --m_queued;
+                }
+
+                std::exception_ptr error;
+                try
+                {
+                    task(worker);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (error && !m_error)
+                    m_error = error;
+                if (--m_unfinished == 0)
+                    m_cv_idle.notify_all();
+
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_work.wait(lock, [this] { return m_stop || m_queued > 0; });
+
+            if (m_stop && m_queued <= 0)
+                return;
+        }
+    }
+}
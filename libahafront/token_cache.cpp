@@ -0,0 +1,373 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/token_cache.hpp"
+
+#include <fstream>
+#include <random>
+#include <bit>
+#include <cstring>
+#include <cstdio>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace
+{
+    using namespace aha::front;
+
+    constexpr char token_stream_magic[8] = { 'A', 'H', 'A', 'T', 'O', 'K', 'S', '\0' };
+    constexpr std::uint32_t token_stream_format_version = 1;
+
+    static_assert(sizeof(token_stream_header) == 48);
+    static_assert(sizeof(token_record) == 40);
+    static_assert(std::is_trivially_copyable_v<token_record>);
+
+    template <typename T, std::size_t I = 0>
+    constexpr std::uint32_t index_of()
+    {
+        if constexpr (std::is_same_v<std::variant_alternative_t<I, decltype(token::data)>, T>)
+            return I;
+        else
+            return index_of<T, I + 1>();
+    }
+}
+
+namespace aha::front
+{
+    std::uint64_t hash_source(std::string_view content, std::uint64_t seed)
+    {
+        std::uint64_t hash = seed;
+        for (char ch : content)
+        {
+            hash ^= static_cast<unsigned char>(ch);
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
+    bool write_token_stream(const std::filesystem::path& path,
+        std::uint64_t source_hash, std::uint64_t source_size, std::span<const token> tokens)
+    {
+        std::vector<token_record> records;
+        std::u8string strings;
+        records.reserve(tokens.size());
+
+        for (auto& tok : tokens)
+        {
+            token_record rec { };
+            rec.kind = static_cast<std::uint32_t>(tok.data.index());
+            rec.beg = tok.beg;
+            rec.end = tok.end;
+
+            bool ok = std::visit([&](auto& t) {
+                using T = std::decay_t<decltype(t)>;
+
+                if constexpr (std::is_same_v<T, token_error>)
+                {
+                    // message is not owned by the token
+                    return false;
+                }
+                else
+                {
+                    if constexpr (std::is_same_v<T, token_indent>)
+                    {
+                        rec.aux = t.level;
+                    }
+                    else if constexpr (std::is_same_v<T, token_number>)
+                    {
+                        rec.aux = t.radix | (static_cast<std::uint32_t>(t.postfix) << 8) | (t.is_float ? 1u << 16 : 0);
+                        rec.value = t.is_float ? std::bit_cast<std::uint64_t>(t.floating) : t.integer;
+                    }
+                    else if constexpr (requires { t.delimiter; })
+                    {
+                        rec.aux = t.delimiter;
+                    }
+
+                    if constexpr (requires { t.str; })
+                    {
+                        rec.str_offset = static_cast<std::uint32_t>(strings.size());
+                        rec.str_size = static_cast<std::uint32_t>(t.str.size());
+                        strings += t.str;
+                    }
+                    return true;
+                }
+            }, tok.data);
+
+            if (!ok)
+                return false;
+
+            records.push_back(rec);
+        }
+
+        if (strings.size() > std::numeric_limits<std::uint32_t>::max())
+            return false;
+
+        token_stream_header header { };
+        std::memcpy(header.magic, token_stream_magic, sizeof(header.magic));
+        header.format_version = token_stream_format_version;
+        header.lexer_version = lexer::version;
+        header.source_hash = source_hash;
+        header.source_size = source_size;
+        header.token_count = records.size();
+        header.string_table_size = strings.size();
+
+        // write to a temporary file and rename it, so that readers never see a partial stream
+        auto tmp = path;
+        tmp += ".tmp" + std::to_string(std::random_device{ }());
+
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(token_record));
+            file.write(reinterpret_cast<const char*>(strings.data()), strings.size());
+
+            if (!file)
+            {
+                file.close();
+                std::error_code ec;
+                std::filesystem::remove(tmp, ec);
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+
+        return true;
+    }
+
+    struct token_stream_view::mapping
+    {
+        boost::interprocess::file_mapping file;
+        boost::interprocess::mapped_region region;
+    };
+
+    token_stream_view::token_stream_view(const std::filesystem::path& path)
+    {
+        namespace bip = boost::interprocess;
+
+        try
+        {
+            bip::file_mapping file(path.string().c_str(), bip::read_only);
+            bip::mapped_region region(file, bip::read_only);
+            m_mapping.reset(new mapping { std::move(file), std::move(region) });
+        }
+        catch (bip::interprocess_exception& ex)
+        {
+            throw token_stream_error(ex.what());
+        }
+
+        auto base = static_cast<const char*>(m_mapping->region.get_address());
+        auto size = m_mapping->region.get_size();
+
+        if (size < sizeof(token_stream_header))
+            throw token_stream_error("file is too small");
+
+        m_header = reinterpret_cast<const token_stream_header*>(base);
+
+        if (std::memcmp(m_header->magic, token_stream_magic, sizeof(token_stream_magic)) != 0)
+            throw token_stream_error("invalid magic");
+        if (m_header->format_version != token_stream_format_version)
+            throw token_stream_error("unsupported format version");
+
+        auto records_size = m_header->token_count * sizeof(token_record);
+        if (m_header->token_count > size / sizeof(token_record)
+            || size != sizeof(token_stream_header) + records_size + m_header->string_table_size)
+        {
+            throw token_stream_error("size mismatch");
+        }
+
+        m_records = reinterpret_cast<const token_record*>(base + sizeof(token_stream_header));
+        m_strings = reinterpret_cast<const char8_t*>(base + sizeof(token_stream_header) + records_size);
+    }
+
+    token_stream_view::token_stream_view(token_stream_view&& other) noexcept = default;
+    token_stream_view& token_stream_view::operator =(token_stream_view&& other) noexcept = default;
+    token_stream_view::~token_stream_view() = default;
+
+    const token_stream_header& token_stream_view::getHeader() const
+    {
+        return *m_header;
+    }
+
+    std::size_t token_stream_view::size() const
+    {
+        return m_header->token_count;
+    }
+
+    const token_record* token_stream_view::begin() const
+    {
+        return m_records;
+    }
+
+    const token_record* token_stream_view::end() const
+    {
+        return m_records + m_header->token_count;
+    }
+
+    const token_record& token_stream_view::operator [](std::size_t idx) const
+    {
+        return m_records[idx];
+    }
+
+    std::u8string_view token_stream_view::getString(const token_record& rec) const
+    {
+        if (static_cast<std::uint64_t>(rec.str_offset) + rec.str_size > m_header->string_table_size)
+            throw token_stream_error("string out of range");
+
+        return std::u8string_view(m_strings + rec.str_offset, rec.str_size);
+    }
+
+    token token_stream_view::makeToken(const token_record& rec, source& src,
+        std::pmr::memory_resource* resource, string_interner* interner) const
+    {
+        token tok { &src, rec.beg, rec.end, token_newline { } };
+
+        if (!interner)
+            interner = &string_interner::global();
+
+        auto str = [&] { return std::pmr::u8string { getString(rec), resource }; };
+        auto sym = [&] { return interner->intern(getString(rec)); };
+        auto delimiter = static_cast<char8_t>(rec.aux);
+
+        switch (rec.kind)
+        {
+            case index_of<token_indent>():
+                tok.data = token_indent { rec.aux };
+                break;
+            case index_of<token_newline>():
+                break;
+            case index_of<token_punct>():
+                tok.data = token_punct { str() };
+                break;
+            case index_of<token_keyword>():
+                tok.data = token_keyword { str() };
+                break;
+            case index_of<token_contextual_keyword>():
+                tok.data = token_contextual_keyword { str() };
+                break;
+            case index_of<token_identifier>():
+            {
+                auto id = sym();
+                tok.data = token_identifier { id, interner->text(id) };
+                break;
+            }
+            case index_of<token_normal_string>():
+            {
+                auto id = sym();
+                tok.data = token_normal_string { delimiter, id, interner->text(id) };
+                break;
+            }
+            case index_of<token_raw_string>():
+            {
+                auto id = sym();
+                tok.data = token_raw_string { delimiter, id, interner->text(id) };
+                break;
+            }
+            case index_of<token_interpol_string_start>():
+                tok.data = token_interpol_string_start { str() };
+                break;
+            case index_of<token_interpol_string_mid>():
+                tok.data = token_interpol_string_mid { str() };
+                break;
+            case index_of<token_interpol_string_end>():
+                tok.data = token_interpol_string_end { str() };
+                break;
+            case index_of<token_number>():
+            {
+                token_number tn;
+                tn.radix = rec.aux & 0xff;
+                tn.postfix = static_cast<number_postfix>((rec.aux >> 8) & 0xff);
+                tn.is_float = (rec.aux >> 16) & 1;
+                tn.integer = tn.is_float ? 0 : rec.value;
+                tn.floating = tn.is_float ? std::bit_cast<double>(rec.value) : 0;
+                tok.data = tn;
+                break;
+            }
+            default:
+                throw token_stream_error("invalid token kind");
+        }
+
+        return tok;
+    }
+
+    token_cache::token_cache(std::filesystem::path dir)
+        : m_dir(std::move(dir))
+    {
+    }
+
+    token_cache::~token_cache() = default;
+
+    std::optional<token_stream_view> token_cache::find(std::uint64_t source_hash, std::uint64_t source_size) const
+    {
+        auto path = getPath(source_hash);
+
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec))
+            return { };
+
+        try
+        {
+            token_stream_view view(path);
+
+            auto& header = view.getHeader();
+            if (header.lexer_version != lexer::version
+                || header.source_hash != source_hash
+                || header.source_size != source_size)
+            {
+                return { };
+            }
+
+            return view;
+        }
+        catch (token_stream_error&)
+        {
+            // treat a broken entry as a miss; it's overwritten by the next store()
+            return { };
+        }
+    }
+
+    bool token_cache::store(std::uint64_t source_hash, std::uint64_t source_size, std::span<const token> tokens) const
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(m_dir, ec);
+        if (ec)
+            return false;
+
+        return write_token_stream(getPath(source_hash), source_hash, source_size, tokens);
+    }
+
+    std::filesystem::path token_cache::getPath(std::uint64_t source_hash) const
+    {
+        char name[64];
+        std::snprintf(name, sizeof(name), "%016llx.v%u.ahatok",
+            static_cast<unsigned long long>(source_hash), static_cast<unsigned>(lexer::version));
+        return m_dir / name;
+    }
+}
@@ -0,0 +1,206 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+#include "aha/front/trace.hpp"
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <ostream>
+#include <cstdio>
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    struct trace_event
+    {
+        const char* name;
+        std::string detail;
+        clock::time_point beg;
+        clock::time_point end;
+    };
+
+    // the mutex is taken by writeJson() and clear() from other threads, so it is almost never contended
+    struct thread_buffer
+    {
+        unsigned tid;
+        std::mutex mutex;
+        std::vector<trace_event> events;
+    };
+
+    struct trace_registry
+    {
+        std::atomic<bool> enabled { false };
+        clock::time_point epoch = clock::now();
+
+        // buffers outlive their threads, e.g. the workers of a finished thread_pool
+        std::mutex mutex;
+        std::vector<std::unique_ptr<thread_buffer>> buffers;
+    };
+
+    trace_registry& registry()
+    {
+        static trace_registry reg;
+        return reg;
+    }
+
+    thread_buffer& local_buffer()
+    {
+        thread_local thread_buffer* buffer = nullptr;
+
+        if (!buffer)
+        {
+            auto& reg = registry();
+            std::lock_guard lock(reg.mutex);
+
+            reg.buffers.push_back(std::make_unique<thread_buffer>());
+            buffer = reg.buffers.back().get();
+            buffer->tid = static_cast<unsigned>(reg.buffers.size());
+        }
+
+        return *buffer;
+    }
+
+    void write_json_string(std::ostream& os, std::string_view str)
+    {
+        os << '"';
+        for (char ch : str)
+        {
+            if (ch == '"' || ch == '\\')
+            {
+                os << '\\' << ch;
+            }
+            else if (static_cast<unsigned char>(ch) < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                os << buf;
+            }
+            else
+            {
+                os << ch;
+            }
+        }
+        os << '"';
+    }
+
+    // in microseconds, as trace events want
+    double to_us(clock::duration d)
+    {
+        return std::chrono::duration<double, std::micro>(d).count();
+    }
+}
+
+namespace aha::front
+{
+    void tracer::enable(bool enable)
+    {
+        registry().enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    bool tracer::enabled()
+    {
+        return registry().enabled.load(std::memory_order_relaxed);
+    }
+
+    void tracer::clear()
+    {
+        auto& reg = registry();
+        std::lock_guard lock(reg.mutex);
+
+        for (auto& buffer : reg.buffers)
+        {
+            std::lock_guard buffer_lock(buffer->mutex);
+            buffer->events.clear();
+        }
+    }
+
+    void tracer::writeJson(std::ostream& os)
+    {
+        auto& reg = registry();
+        std::lock_guard lock(reg.mutex);
+
+        auto flags = os.flags();
+        auto precision = os.precision();
+        os << std::fixed;
+        os.precision(3);
+
+        os << "{\"traceEvents\":[";
+        bool first = true;
+
+        for (auto& buffer : reg.buffers)
+        {
+            std::lock_guard buffer_lock(buffer->mutex);
+
+            os << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+            first = false;
+
+            for (auto& ev : buffer->events)
+            {
+                os << ",\n{\"name\":";
+                write_json_string(os, ev.name);
+                os << ",\"cat\":\"aha\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                    << ",\"ts\":" << to_us(ev.beg - reg.epoch) << ",\"dur\":" << to_us(ev.end - ev.beg);
+                if (!ev.detail.empty())
+                {
+                    os << ",\"args\":{\"detail\":";
+                    write_json_string(os, ev.detail);
+                    os << "}";
+                }
+                os << "}";
+            }
+        }
+
+        os << "\n]}\n";
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+    trace_span::trace_span(const char* name, std::string_view detail /* = { } */)
+        : m_name(nullptr)
+    {
+        if (tracer::enabled())
+            start(name, std::string(detail));
+    }
+
+    void trace_span::start(const char* name, std::string detail)
+    {
+        m_name = name;
+        m_detail = std::move(detail);
+        m_beg = clock::now();
+    }
+
+    trace_span::~trace_span()
+    {
+        if (!m_name)
+            return;
+
+        auto end = clock::now();
+
+        auto& buffer = local_buffer();
+        std::lock_guard lock(buffer.mutex);
+        buffer.events.push_back({ m_name, std::move(m_detail), m_beg, end });
+    }
+}
@@ -0,0 +1,83 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Im Kyeong-Hyeon (dlarudgus20@naver.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// the strings here are produced from decoded code points, so they are always valid UTF-8.
+
+// String is std::u8string or std::pmr::u8string
+template <typename String>
+inline void append_utf8(String& str, char32_t ch)
+{
+    if (ch < 0x80)
+    {
+        str.push_back(static_cast<char8_t>(ch));
+    }
+    else if (ch < 0x800)
+    {
+        char8_t buf[] = {
+            static_cast<char8_t>(0xc0 | (ch >> 6)),
+            static_cast<char8_t>(0x80 | (ch & 0x3f)) };
+        str.append(buf, 2);
+    }
+    else if (ch < 0x10000)
+    {
+        char8_t buf[] = {
+            static_cast<char8_t>(0xe0 | (ch >> 12)),
+            static_cast<char8_t>(0x80 | ((ch >> 6) & 0x3f)),
+            static_cast<char8_t>(0x80 | (ch & 0x3f)) };
+        str.append(buf, 3);
+    }
+    else
+    {
+        char8_t buf[] = {
+            static_cast<char8_t>(0xf0 | (ch >> 18)),
+            static_cast<char8_t>(0x80 | ((ch >> 12) & 0x3f)),
+            static_cast<char8_t>(0x80 | ((ch >> 6) & 0x3f)),
+            static_cast<char8_t>(0x80 | (ch & 0x3f)) };
+        str.append(buf, 4);
+    }
+}
+
+// decodes the code point at str[pos] and returns its length in bytes
+inline std::size_t decode_utf8(std::u8string_view str, std::size_t pos, char32_t& ch)
+{
+    auto b0 = str[pos];
+
+    if (b0 < 0x80)
+    {
+        ch = b0;
+        return 1;
+    }
+
+    std::size_t length = (b0 >= 0xf0) ? 4 : (b0 >= 0xe0) ? 3 : 2;
+    char32_t ret = b0 & (0x7f >> length);
+    for (std::size_t i = 1; i < length; ++i)
+        ret = (ret << 6) | (str[pos + i] & 0x3f);
+
+    ch = ret;
+    return length;
+}